@@ -0,0 +1,126 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#if defined(DIGEST_BENCHMARK) && (DIGEST_BENCHMARK == 1)
+#include "digest_benchmark.h"
+#include "bootloader_common.h"
+#include "blake2s.h"
+#include "mbed.h"
+#include "mbedtls/sha256.h"
+
+#if !BLAKE2S_ENABLED
+#error "DIGEST_BENCHMARK needs blake2s-enabled in mbed_app.json"
+#endif
+
+/* bytes of the active application hashed per run */
+#ifndef DIGEST_BENCHMARK_SIZE
+#define DIGEST_BENCHMARK_SIZE (128 * 1024)
+#endif
+
+#ifndef DIGEST_BENCHMARK_RUNS
+#define DIGEST_BENCHMARK_RUNS 3
+#endif
+
+static void printResult(const char* name, uint32_t size, uint32_t us)
+{
+    uint32_t rate = (us > 0) ? (uint32_t) (((uint64_t) size * 1000000 / 1024) / us) : 0;
+
+    tr_info("%s: %" PRIu32 " B in %" PRIu32 " us, %" PRIu32 " KiB/s",
+            name, size, us, rate);
+}
+
+/**
+ * Time SHA-256 and BLAKE2s over the active application.
+ * @detail The image is hashed straight from flash in BUFFER_SIZE steps,
+ *         the same steps the boot-time check uses, so only the digest cost
+ *         is measured.
+ */
+void digest_benchmark_run()
+{
+    const uint8_t* image =
+        (const uint8_t*) (MBED_CONF_APP_APPLICATION_START_ADDRESS);
+    uint32_t size = DIGEST_BENCHMARK_SIZE;
+
+    if (size > MBED_CONF_APP_MAX_APPLICATION_SIZE)
+    {
+        size = MBED_CONF_APP_MAX_APPLICATION_SIZE;
+    }
+
+#if defined(MBEDTLS_SHA256_ALT)
+    tr_info("Digest benchmark, SHA-256 in hardware");
+#else
+    tr_info("Digest benchmark, SHA-256 in software");
+#endif
+
+    uint8_t digest[SIZEOF_SHA256];
+    Timer timer;
+
+    for (uint32_t run = 0; run < DIGEST_BENCHMARK_RUNS; run++)
+    {
+        timer.reset();
+        timer.start();
+
+        mbedtls_sha256_context sha256;
+        mbedtls_sha256_init(&sha256);
+        mbedtls_sha256_starts(&sha256, 0);
+
+        for (uint32_t offset = 0; offset < size; offset += BUFFER_SIZE)
+        {
+            uint32_t length = ((size - offset) > BUFFER_SIZE) ?
+                              BUFFER_SIZE : (size - offset);
+
+            mbedtls_sha256_update(&sha256, &image[offset], length);
+        }
+
+        mbedtls_sha256_finish(&sha256, digest);
+        mbedtls_sha256_free(&sha256);
+
+        timer.stop();
+        uint32_t sha256Time = timer.read_us();
+
+        timer.reset();
+        timer.start();
+
+        blake2s_context blake2s;
+        blake2s_starts(&blake2s);
+
+        for (uint32_t offset = 0; offset < size; offset += BUFFER_SIZE)
+        {
+            uint32_t length = ((size - offset) > BUFFER_SIZE) ?
+                              BUFFER_SIZE : (size - offset);
+
+            blake2s_update(&blake2s, &image[offset], length);
+        }
+
+        blake2s_finish(&blake2s, digest);
+
+        timer.stop();
+        uint32_t blake2sTime = timer.read_us();
+
+        printResult("SHA256", size, sha256Time);
+        printResult("BLAKE2s", size, blake2sTime);
+
+        if (sha256Time > 0)
+        {
+            tr_info("BLAKE2s takes %" PRIu32 "%% of the SHA-256 time",
+                    (uint32_t) ((uint64_t) blake2sTime * 100 / sha256Time));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,433 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "NANDBlockMap.h"
+#include "bootloader_common.h"
+
+#include <string.h>
+
+NANDBlockMap::NANDBlockMap(NANDArray& array, uint32_t pageSize,
+                           uint32_t pagesPerBlock, uint32_t blockCount)
+    : _array(array),
+      _pageSize(pageSize),
+      _pagesPerBlock(pagesPerBlock),
+      _blockCount(blockCount),
+      _tableSlot(NAND_TABLE_BLOCKS - 1)
+{
+    memset(&_table, 0, sizeof(_table));
+}
+
+int NANDBlockMap::init()
+{
+    /* the table must fit in one page and be able to index every block */
+    if ((sizeof(_table) > _pageSize) || (_blockCount > 0xFFFF) ||
+        (_blockCount <= NAND_TABLE_BLOCKS + NAND_MAX_BAD_BLOCKS))
+    {
+        return NAND_ERROR;
+    }
+
+    int result = loadTable();
+
+    /* first use, or both copies lost: rebuild from the bad block markers */
+    if (result != NAND_SUCCESS)
+    {
+        tr_info("Scanning NAND for bad blocks");
+
+        result = scan();
+
+        if (result == NAND_SUCCESS)
+        {
+            /* the scan is repeated on the next boot if this fails */
+            if (saveTable() != NAND_SUCCESS)
+            {
+                tr_warning("NAND bad block table not saved");
+            }
+        }
+    }
+
+    return result;
+}
+
+uint32_t NANDBlockMap::getBlockCount() const
+{
+    /* bad block reserve is excluded so the size is the same on all parts */
+    return _blockCount - NAND_TABLE_BLOCKS - NAND_MAX_BAD_BLOCKS;
+}
+
+uint32_t NANDBlockMap::getBadBlockCount() const
+{
+    /* every spare handed out either failed itself or replaced a bad block */
+    uint32_t count = _table.badBlockCount + _table.spareCount;
+
+    for (uint32_t slot = 0; slot < NAND_TABLE_BLOCKS; slot++)
+    {
+        if (_table.tableBlockBad & (1 << slot))
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+uint32_t NANDBlockMap::getPhysicalBlock(uint32_t logicalBlock) const
+{
+    /* a block may have been remapped more than once, latest entry wins */
+    for (uint32_t index = _table.remapCount; index > 0; index--)
+    {
+        if (_table.remapLogical[index - 1] == logicalBlock)
+        {
+            return _table.remapPhysical[index - 1];
+        }
+    }
+
+    return skipBadBlocks(_table, logicalBlock);
+}
+
+int NANDBlockMap::programPage(uint32_t logicalBlock, uint32_t page,
+                              const uint8_t* buffer)
+{
+    int result = NAND_ERROR_WORN;
+
+    while (result == NAND_ERROR_WORN)
+    {
+        uint32_t row = getPhysicalBlock(logicalBlock) * _pagesPerBlock + page;
+
+        result = _array.programPage(row, buffer, _pageSize);
+
+        /* move the pages before this one to a spare and try again there */
+        if (result == NAND_ERROR_WORN)
+        {
+            int retired = retireBlock(logicalBlock, page);
+
+            if (retired != NAND_SUCCESS)
+            {
+                result = retired;
+            }
+        }
+    }
+
+    return result;
+}
+
+int NANDBlockMap::eraseBlock(uint32_t logicalBlock)
+{
+    int result = _array.eraseBlock(getPhysicalBlock(logicalBlock));
+
+    /* the spare is erased when it is handed out */
+    if (result == NAND_ERROR_WORN)
+    {
+        result = retireBlock(logicalBlock, 0);
+    }
+
+    return result;
+}
+
+/**
+ * Find the newest valid table in the table blocks.
+ */
+int NANDBlockMap::loadTable()
+{
+    int result = NAND_ERROR;
+
+    for (uint32_t slot = 0; slot < NAND_TABLE_BLOCKS; slot++)
+    {
+        uint32_t block = _blockCount - NAND_TABLE_BLOCKS + slot;
+        nand_block_table_t candidate;
+
+        /* unreadable copies are skipped, the other one may be fine */
+        if (_array.readPage(block * _pagesPerBlock, 0, (uint8_t*) &candidate,
+                            sizeof(candidate)) != NAND_SUCCESS)
+        {
+            continue;
+        }
+
+        uint32_t crc = crc32Update(0, (const uint8_t*) &candidate,
+                                   offsetof(nand_block_table_t, crc));
+
+        if ((candidate.magic == NAND_TABLE_MAGIC) &&
+            (candidate.crc == crc) &&
+            ((result != NAND_SUCCESS) ||
+             (candidate.sequence > _table.sequence)))
+        {
+            _table = candidate;
+            _tableSlot = slot;
+            result = NAND_SUCCESS;
+        }
+    }
+
+    /* the older copy lacks the latest remaps, so an inconsistent newest
+       table is rebuilt by scanning instead of falling back to it */
+    if ((result == NAND_SUCCESS) && !isTableConsistent(_table))
+    {
+        tr_warning("NAND table in block %" PRIu32 " is inconsistent",
+                   _blockCount - NAND_TABLE_BLOCKS + _tableSlot);
+
+        result = NAND_ERROR;
+    }
+
+    if (result == NAND_SUCCESS)
+    {
+        tr_debug("NAND table %" PRIu32 " bad blocks", getBadBlockCount());
+    }
+
+    return result;
+}
+
+/**
+ * Build the table from the bad block markers of every block.
+ */
+int NANDBlockMap::scan()
+{
+    const uint32_t dataBlocks = _blockCount - NAND_TABLE_BLOCKS;
+    const uint32_t sequence = _table.sequence;
+    int result = NAND_SUCCESS;
+
+    /* keep the sequence, so the rebuilt table supersedes a stored one */
+    memset(&_table, 0, sizeof(_table));
+    _table.sequence = sequence;
+    _table.magic = NAND_TABLE_MAGIC;
+    _table.blockCount = _blockCount;
+    _table.pagesPerBlock = _pagesPerBlock;
+
+    for (uint32_t block = 0; (block < _blockCount) && (result == NAND_SUCCESS); block++)
+    {
+        bool bad = false;
+
+        result = _array.readBadBlockMarker(block, &bad);
+
+        if ((result == NAND_SUCCESS) && bad)
+        {
+            if (block >= dataBlocks)
+            {
+                _table.tableBlockBad |= 1 << (block - dataBlocks);
+            }
+            else if (_table.badBlockCount < NAND_MAX_BAD_BLOCKS)
+            {
+                _table.badBlocks[_table.badBlockCount++] = block;
+            }
+            else
+            {
+                tr_error("More than %d bad NAND blocks", NAND_MAX_BAD_BLOCKS);
+                result = NAND_ERROR;
+            }
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Write the table to the table block not holding the current copy.
+ */
+int NANDBlockMap::saveTable()
+{
+    int result = NAND_ERROR;
+
+    _table.sequence++;
+
+    for (uint32_t attempt = 0;
+         (attempt < NAND_TABLE_BLOCKS) && (result != NAND_SUCCESS);
+         attempt++)
+    {
+        uint32_t slot = (_tableSlot + 1 + attempt) % NAND_TABLE_BLOCKS;
+        uint32_t block = _blockCount - NAND_TABLE_BLOCKS + slot;
+
+        /* never erase a bad block, it would clear the marker */
+        if (_table.tableBlockBad & (1 << slot))
+        {
+            continue;
+        }
+
+        _table.crc = getTableCrc();
+
+        result = _array.eraseBlock(block);
+
+        if (result == NAND_SUCCESS)
+        {
+            result = _array.programPage(block * _pagesPerBlock,
+                                        (const uint8_t*) &_table,
+                                        sizeof(_table));
+        }
+
+        if (result == NAND_SUCCESS)
+        {
+            _tableSlot = slot;
+        }
+        else if (result == NAND_ERROR_WORN)
+        {
+            _table.tableBlockBad |= 1 << slot;
+            _array.writeBadBlockMarker(block);
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    /* no table block left */
+    if (result == NAND_ERROR_WORN)
+    {
+        result = NAND_ERROR;
+    }
+
+    return result;
+}
+
+/**
+ * Replace the physical block behind logicalBlock with a spare.
+ * @param logicalBlock  Block that failed to program or erase.
+ * @param pages         Number of pages already written to the block.
+ */
+int NANDBlockMap::retireBlock(uint32_t logicalBlock, uint32_t pages)
+{
+    const uint32_t dataBlocks = _blockCount - NAND_TABLE_BLOCKS;
+    const uint32_t worn = getPhysicalBlock(logicalBlock);
+    int result = NAND_ERROR_WORN;
+
+    while (result == NAND_ERROR_WORN)
+    {
+        uint32_t spare = skipBadBlocks(_table, getBlockCount() + _table.spareCount);
+
+        if ((_table.spareCount >= NAND_MAX_BAD_BLOCKS) || (spare >= dataBlocks))
+        {
+            tr_error("No spare NAND blocks left");
+            return NAND_ERROR;
+        }
+
+        /* spares are not reused, a failed one counts as a bad block */
+        _table.spareCount++;
+
+        result = _array.eraseBlock(spare);
+
+        for (uint32_t page = 0; (page < pages) && (result == NAND_SUCCESS); page++)
+        {
+            result = _array.copyPage(worn * _pagesPerBlock + page,
+                                     spare * _pagesPerBlock + page);
+        }
+
+        if (result == NAND_SUCCESS)
+        {
+            _table.remapLogical[_table.remapCount] = logicalBlock;
+            _table.remapPhysical[_table.remapCount] = spare;
+            _table.remapCount++;
+        }
+        else if (result == NAND_ERROR_WORN)
+        {
+            _array.writeBadBlockMarker(spare);
+        }
+    }
+
+    if (result == NAND_SUCCESS)
+    {
+        tr_warning("NAND block %" PRIu32 " worn out, replaced by %" PRIu32,
+                   worn, getPhysicalBlock(logicalBlock));
+
+        /* table first, so the map never points at a marked block */
+        result = saveTable();
+
+        _array.writeBadBlockMarker(worn);
+    }
+
+    return result;
+}
+
+/**
+ * Check the entries of a table whose crc matches against the geometry.
+ */
+bool NANDBlockMap::isTableConsistent(const nand_block_table_t& table) const
+{
+    const uint32_t dataBlocks = _blockCount - NAND_TABLE_BLOCKS;
+
+    if ((table.blockCount != _blockCount) ||
+        (table.pagesPerBlock != _pagesPerBlock) ||
+        (table.badBlockCount > NAND_MAX_BAD_BLOCKS) ||
+        (table.spareCount > NAND_MAX_BAD_BLOCKS) ||
+        (table.remapCount > table.spareCount) ||
+        (table.tableBlockBad >> NAND_TABLE_BLOCKS))
+    {
+        return false;
+    }
+
+    /* skipBadBlocks relies on the factory bad blocks being sorted */
+    for (uint32_t bad = 0; bad < table.badBlockCount; bad++)
+    {
+        if ((table.badBlocks[bad] >= dataBlocks) ||
+            ((bad > 0) && (table.badBlocks[bad] <= table.badBlocks[bad - 1])))
+        {
+            return false;
+        }
+    }
+
+    /* spares are handed out in order above the last logical block */
+    const uint32_t firstSpare = skipBadBlocks(table, getBlockCount());
+    const uint32_t spareEnd = skipBadBlocks(table, getBlockCount() +
+                                                   table.spareCount);
+
+    for (uint32_t index = 0; index < table.remapCount; index++)
+    {
+        const uint32_t physicalBlock = table.remapPhysical[index];
+
+        if ((table.remapLogical[index] >= getBlockCount()) ||
+            (physicalBlock < firstSpare) || (physicalBlock >= spareEnd) ||
+            (physicalBlock >= dataBlocks))
+        {
+            return false;
+        }
+
+        for (uint32_t bad = 0; bad < table.badBlockCount; bad++)
+        {
+            if (table.badBlocks[bad] == physicalBlock)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Map an index over the good blocks of table to a physical block.
+ */
+uint32_t NANDBlockMap::skipBadBlocks(const nand_block_table_t& table,
+                                     uint32_t index)
+{
+    uint32_t physicalBlock = index;
+
+    /* bad blocks are sorted, each one at or before the candidate shifts it */
+    for (uint32_t bad = 0; bad < table.badBlockCount; bad++)
+    {
+        if (table.badBlocks[bad] <= physicalBlock)
+        {
+            physicalBlock++;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return physicalBlock;
+}
+
+uint32_t NANDBlockMap::getTableCrc() const
+{
+    return crc32Update(0, (const uint8_t*) &_table,
+                       offsetof(nand_block_table_t, crc));
+}
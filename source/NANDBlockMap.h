@@ -0,0 +1,174 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef NAND_BLOCK_MAP_H
+#define NAND_BLOCK_MAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Upper bound on factory and grown bad blocks, NAND vendors guarantee 2% */
+#ifndef NAND_MAX_BAD_BLOCKS
+#define NAND_MAX_BAD_BLOCKS 40
+#endif
+
+/* Blocks at the top of the die holding the bad block table */
+#define NAND_TABLE_BLOCKS 2
+
+#define NAND_TABLE_MAGIC 0x4E424254
+
+enum {
+    NAND_SUCCESS     = 0,
+    NAND_ERROR       = -1, /* bus error, timeout or uncorrectable page */
+    NAND_ERROR_WORN  = -2  /* program or erase failed, the block is bad */
+};
+
+/**
+ * Raw access to the physical pages and blocks of a NAND die.
+ * @detail Rows are physical page indices, block * pagesPerBlock + page.
+ */
+class NANDArray
+{
+public:
+    virtual ~NANDArray() {}
+
+    /**
+     * Read length bytes from column of the page at row.
+     * @return NAND_ERROR if on-die ECC could not correct the page.
+     */
+    virtual int readPage(uint32_t row, uint32_t column,
+                         uint8_t* buffer, uint32_t length) = 0;
+
+    /**
+     * Program length bytes from column 0 of the page at row, the rest of
+     * the page is left erased.
+     */
+    virtual int programPage(uint32_t row, const uint8_t* buffer,
+                            uint32_t length) = 0;
+
+    /**
+     * Copy a page inside the die, without transferring it over the bus.
+     */
+    virtual int copyPage(uint32_t sourceRow, uint32_t destinationRow) = 0;
+
+    virtual int eraseBlock(uint32_t block) = 0;
+
+    /**
+     * Read the bad block marker with ECC disabled, so a factory bad block
+     * with garbage in its first page is reported as bad, not as an error.
+     */
+    virtual int readBadBlockMarker(uint32_t block, bool* bad) = 0;
+
+    /**
+     * Write the bad block marker, so the block is found by a later scan.
+     */
+    virtual int writeBadBlockMarker(uint32_t block) = 0;
+};
+
+/**
+ * Bad block table, stored in the first page of a table block.
+ * @detail Factory bad blocks are skipped: logical blocks are numbered over
+ *         the good blocks, so the table only changes when a block wears
+ *         out. A worn block is replaced by the next spare from the
+ *         NAND_MAX_BAD_BLOCKS reserve above the last logical block and
+ *         recorded as a remap entry, latest entry winning. The crc covers
+ *         the table up to the crc field.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint16_t blockCount;
+    uint16_t pagesPerBlock;
+    uint16_t badBlockCount;   /* factory bad blocks in badBlocks */
+    uint16_t spareCount;      /* spares handed out, including failed ones */
+    uint16_t remapCount;      /* entries in remapLogical/remapPhysical */
+    uint16_t tableBlockBad;   /* bit per table block */
+    uint16_t badBlocks[NAND_MAX_BAD_BLOCKS];
+    uint16_t remapLogical[NAND_MAX_BAD_BLOCKS];
+    uint16_t remapPhysical[NAND_MAX_BAD_BLOCKS];
+    uint32_t crc;
+} nand_block_table_t;
+
+/**
+ * Logical to physical block mapping for raw NAND.
+ * @detail The table is loaded from the table blocks at start-up. The
+ *         markers of all blocks are only scanned if no valid table is
+ *         found, e.g., on first use. A table is only valid if its factory
+ *         bad blocks are sorted and below the table blocks and every remap
+ *         target is a spare that has been handed out. Updates are written to the table
+ *         block not holding the current table, so a power cut leaves the
+ *         previous one intact.
+ *         Program and erase failures retire the block: the pages written
+ *         before the failure are copied to a spare, the block is marked
+ *         bad and the table saved before the operation is retried. Pages
+ *         must be programmed in order within a block, as NAND requires.
+ */
+class NANDBlockMap
+{
+public:
+    NANDBlockMap(NANDArray& array, uint32_t pageSize,
+                 uint32_t pagesPerBlock, uint32_t blockCount);
+
+    /**
+     * Load the bad block table, or build it by scanning.
+     */
+    int init();
+
+    /**
+     * Number of logical blocks, the same on all parts of a geometry.
+     */
+    uint32_t getBlockCount() const;
+
+    /**
+     * Number of factory and grown bad blocks.
+     */
+    uint32_t getBadBlockCount() const;
+
+    uint32_t getPhysicalBlock(uint32_t logicalBlock) const;
+
+    /**
+     * Program a page of a logical block, retiring the block on failure.
+     */
+    int programPage(uint32_t logicalBlock, uint32_t page,
+                    const uint8_t* buffer);
+
+    /**
+     * Erase a logical block, retiring the block on failure.
+     */
+    int eraseBlock(uint32_t logicalBlock);
+
+private:
+    int loadTable();
+    int scan();
+    int saveTable();
+    int retireBlock(uint32_t logicalBlock, uint32_t pages);
+    bool isTableConsistent(const nand_block_table_t& table) const;
+    static uint32_t skipBadBlocks(const nand_block_table_t& table,
+                                  uint32_t index);
+    uint32_t getTableCrc() const;
+
+    NANDArray& _array;
+    const uint32_t _pageSize;
+    const uint32_t _pagesPerBlock;
+    const uint32_t _blockCount;
+
+    nand_block_table_t _table;
+    uint32_t _tableSlot;
+};
+
+#endif // NAND_BLOCK_MAP_H
@@ -0,0 +1,221 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#if defined(MBED_CONF_APP_SD_CRC_READ) && MBED_CONF_APP_SD_CRC_READ
+
+#include "SDCRCBlockDevice.h"
+#include "bootloader_common.h"
+
+#include <inttypes.h>
+
+#define SD_BLOCK_SIZE                   512
+#define SD_TOKEN_START_BLOCK            0xFE
+
+/* card type of sd-driver for block addressed SDHC and SDXC cards */
+#ifndef SDCARD_V2HC
+#define SDCARD_V2HC                     3
+#endif
+
+/* result of readDataBlock for a block with a wrong CRC */
+#define SD_CRC_MISMATCH                 1
+
+/* read access time limit for SDHC and SDXC cards */
+#define SD_READ_TIMEOUT_US              100000
+
+SDCRCBlockDevice::SDCRCBlockDevice(PinName mosi, PinName miso,
+                                   PinName sclk, PinName cs,
+                                   uint64_t hz)
+    : SDBlockDevice(mosi, miso, sclk, cs, hz),
+      _crcErrors(0)
+{
+}
+
+int SDCRCBlockDevice::init()
+{
+    _crcErrors = 0;
+
+    return SDBlockDevice::init();
+}
+
+int SDCRCBlockDevice::read(void* b, bd_addr_t addr, bd_size_t size)
+{
+    if (!is_valid_read(addr, size))
+    {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    lock();
+
+    if (!_is_initialized)
+    {
+        unlock();
+
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    uint8_t* buffer = (uint8_t*) b;
+    uint32_t block = addr / SD_BLOCK_SIZE;
+    uint32_t count = size / SD_BLOCK_SIZE;
+    int result = BD_ERROR_OK;
+
+    while ((count > 0) && (result == BD_ERROR_OK))
+    {
+        uint32_t done = 0;
+
+        /* stream blocks until the end or the first CRC mismatch, the
+           card stays selected after a successful read command */
+        if (_cmd(CMD18_READ_MULTIPLE_BLOCK, getCardAddress(block)) == BD_ERROR_OK)
+        {
+            while ((done < count) && (result == BD_ERROR_OK))
+            {
+                result = readDataBlock(&buffer[done * SD_BLOCK_SIZE]);
+
+                if (result == BD_ERROR_OK)
+                {
+                    done++;
+                }
+            }
+
+            _deselect();
+
+            /* sd-driver skips the stuff byte and waits while the card is busy */
+            if (_cmd(CMD12_STOP_TRANSMISSION, 0) != BD_ERROR_OK)
+            {
+                result = BD_ERROR_DEVICE_ERROR;
+            }
+        }
+        else
+        {
+            result = BD_ERROR_DEVICE_ERROR;
+        }
+
+        buffer += done * SD_BLOCK_SIZE;
+        block  += done;
+        count  -= done;
+
+        /* re-read the corrupted block right away */
+        if (result == SD_CRC_MISMATCH)
+        {
+            _crcErrors++;
+
+            tr_warning("SD block %" PRIu32 " failed CRC check, re-reading", block);
+
+            result = readSingleBlock(buffer, block);
+
+            if (result == BD_ERROR_OK)
+            {
+                buffer += SD_BLOCK_SIZE;
+                block++;
+                count--;
+            }
+        }
+    }
+
+    unlock();
+
+    return result;
+}
+
+uint32_t SDCRCBlockDevice::get_crc_error_count() const
+{
+    return _crcErrors;
+}
+
+/**
+ * Receive one data block and check its CRC16.
+ * @return BD_ERROR_OK, SD_CRC_MISMATCH or BD_ERROR_DEVICE_ERROR.
+ */
+int SDCRCBlockDevice::readDataBlock(uint8_t* buffer)
+{
+    uint8_t token = 0xFF;
+
+    Timer timer;
+    timer.start();
+
+    while ((token == 0xFF) && (timer.read_us() < SD_READ_TIMEOUT_US))
+    {
+        token = _spi.write(0xFF);
+    }
+
+    if (token != SD_TOKEN_START_BLOCK)
+    {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    uint8_t crc[2];
+
+    _spi.write(NULL, 0, (char*) buffer, SD_BLOCK_SIZE);
+    _spi.write(NULL, 0, (char*) crc, sizeof(crc));
+
+    uint16_t expected = (uint16_t) ((crc[0] << 8) | crc[1]);
+
+    return (crc16Update(0, buffer, SD_BLOCK_SIZE) == expected) ?
+           BD_ERROR_OK : SD_CRC_MISMATCH;
+}
+
+/**
+ * Read one block with READ_SINGLE_BLOCK until its CRC matches.
+ */
+int SDCRCBlockDevice::readSingleBlock(uint8_t* buffer, uint32_t block)
+{
+    int result = BD_ERROR_DEVICE_ERROR;
+
+    for (uint32_t attempt = 0;
+         (attempt < SD_CRC_READ_RETRIES) && (result != BD_ERROR_OK);
+         attempt++)
+    {
+        if (_cmd(CMD17_READ_SINGLE_BLOCK, getCardAddress(block)) == BD_ERROR_OK)
+        {
+            result = readDataBlock(buffer);
+
+            _deselect();
+        }
+        else
+        {
+            result = BD_ERROR_DEVICE_ERROR;
+        }
+
+        if (result == SD_CRC_MISMATCH)
+        {
+            _crcErrors++;
+        }
+    }
+
+    if (result != BD_ERROR_OK)
+    {
+        tr_error("SD block %" PRIu32 " unreadable", block);
+
+        result = BD_ERROR_DEVICE_ERROR;
+    }
+
+    return result;
+}
+
+/**
+ * SDHC and SDXC cards are addressed in blocks, SDSC cards in bytes.
+ */
+uint32_t SDCRCBlockDevice::getCardAddress(uint32_t block) const
+{
+    return (_card_type == SDCARD_V2HC) ? block : (block * SD_BLOCK_SIZE);
+}
+
+#endif
@@ -0,0 +1,76 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef SD_CRC_BLOCK_DEVICE_H
+#define SD_CRC_BLOCK_DEVICE_H
+
+#include "mbed.h"
+#include "SDBlockDevice.h"
+
+/* Extra attempts to read a block whose data CRC does not match */
+#ifndef SD_CRC_READ_RETRIES
+#define SD_CRC_READ_RETRIES 3
+#endif
+
+/**
+ * SDBlockDevice with CRC checked reads.
+ * @detail sd-driver discards the CRC16 the card sends after every data
+ *         block. This class replaces the read path: blocks are streamed
+ *         with READ_MULTIPLE_BLOCK and the CRC16 of each block is checked
+ *         as it arrives. A block failing the check is re-read on its own
+ *         with READ_SINGLE_BLOCK, up to SD_CRC_READ_RETRIES more times,
+ *         before the stream resumes, so a corrupted transfer costs one
+ *         block instead of a failed image hash.
+ *         Cards send data CRCs in SPI mode whether or not CRC_ON_OFF
+ *         is set, so the initialisation of sd-driver is unchanged.
+ *         Commands go through the SPI bus, chip select, lock and command
+ *         code of sd-driver, which also does initialisation, programming
+ *         and erasing. These are private in the pinned sd-driver, so the
+ *         class is only built with the sd-crc-read option and an
+ *         sd-driver that makes them protected.
+ */
+class SDCRCBlockDevice : public SDBlockDevice
+{
+public:
+    /**
+     * @param mosi  SPI master out, slave in pin
+     * @param miso  SPI master in, slave out pin
+     * @param sclk  SPI clock pin
+     * @param cs    SPI chip select pin
+     * @param hz    SPI clock frequency for data transfers
+     */
+    SDCRCBlockDevice(PinName mosi, PinName miso, PinName sclk, PinName cs,
+                     uint64_t hz = 1000000);
+
+    virtual int init();
+    virtual int read(void* buffer, bd_addr_t addr, bd_size_t size);
+
+    /**
+     * Number of data blocks that failed the CRC check since init().
+     */
+    uint32_t get_crc_error_count() const;
+
+private:
+    int readDataBlock(uint8_t* buffer);
+    int readSingleBlock(uint8_t* buffer, uint32_t block);
+    uint32_t getCardAddress(uint32_t block) const;
+
+    uint32_t _crcErrors;
+};
+
+#endif // SD_CRC_BLOCK_DEVICE_H
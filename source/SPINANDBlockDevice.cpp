@@ -0,0 +1,540 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "SPINANDBlockDevice.h"
+
+/* command set */
+#define SPI_NAND_CMD_RESET              0xFF
+#define SPI_NAND_CMD_GET_FEATURE        0x0F
+#define SPI_NAND_CMD_SET_FEATURE        0x1F
+#define SPI_NAND_CMD_WRITE_ENABLE       0x06
+#define SPI_NAND_CMD_PAGE_READ          0x13
+#define SPI_NAND_CMD_CACHE_READ_SEQ     0x31
+#define SPI_NAND_CMD_CACHE_READ_LAST    0x3F
+#define SPI_NAND_CMD_READ_CACHE         0x03
+#define SPI_NAND_CMD_PROGRAM_LOAD       0x02
+#define SPI_NAND_CMD_PROGRAM_EXECUTE    0x10
+#define SPI_NAND_CMD_BLOCK_ERASE        0xD8
+
+/* feature registers */
+#define SPI_NAND_FEATURE_BLOCK_LOCK     0xA0
+#define SPI_NAND_FEATURE_CONFIG         0xB0
+#define SPI_NAND_FEATURE_STATUS         0xC0
+
+/* configuration register bits */
+#define SPI_NAND_CONFIG_ECC_EN          0x10
+
+/* status register bits */
+#define SPI_NAND_STATUS_OIP             0x01
+#define SPI_NAND_STATUS_E_FAIL          0x04
+#define SPI_NAND_STATUS_P_FAIL          0x08
+#define SPI_NAND_STATUS_ECC_MASK        0x30
+#define SPI_NAND_STATUS_ECC_FAIL        0x20
+
+/* longest operation is a block erase, typically a few ms */
+#define SPI_NAND_TIMEOUT_US             100000
+
+SPINANDBlockDevice::SPINANDBlockDevice(PinName mosi, PinName miso,
+                                       PinName sclk, PinName cs,
+                                       uint32_t pageSize,
+                                       uint32_t pagesPerBlock,
+                                       uint32_t blockCount,
+                                       int hz)
+    : _spi(mosi, miso, sclk),
+      _cs(cs, 1),
+      _pageSize(pageSize),
+      _pagesPerBlock(pagesPerBlock),
+      _map(*this, pageSize, pagesPerBlock, blockCount),
+      _initialized(false)
+{
+    _spi.format(8, 0);
+    _spi.frequency(hz);
+}
+
+int SPINANDBlockDevice::init()
+{
+    const uint8_t reset = SPI_NAND_CMD_RESET;
+
+    writeCommand(&reset, sizeof(reset));
+
+    int result = waitReady();
+
+    /* all blocks are write protected after power up */
+    if (result == NAND_SUCCESS)
+    {
+        result = setFeature(SPI_NAND_FEATURE_BLOCK_LOCK, 0x00);
+    }
+
+    /* load the bad block table, scanning only on first use */
+    if (result == NAND_SUCCESS)
+    {
+        result = _map.init();
+    }
+
+    _initialized = (result == NAND_SUCCESS);
+
+    return _initialized ? BD_ERROR_OK : BD_ERROR_DEVICE_ERROR;
+}
+
+int SPINANDBlockDevice::deinit()
+{
+    _initialized = false;
+
+    return BD_ERROR_OK;
+}
+
+int SPINANDBlockDevice::read(void* b, bd_addr_t addr, bd_size_t size)
+{
+    if ((!_initialized) || (addr + size > this->size()))
+    {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    uint8_t* buffer = (uint8_t*) b;
+    const uint32_t blockSize = _pageSize * _pagesPerBlock;
+    int result = NAND_SUCCESS;
+
+    while ((size > 0) && (result == NAND_SUCCESS))
+    {
+        /* pages are streamed sequentially up to the end of the block, the
+           next logical block may not be the next physical one */
+        uint32_t logicalBlock = addr / blockSize;
+        uint32_t blockOffset = addr % blockSize;
+        uint32_t run = ((blockSize - blockOffset) < size) ?
+                       (blockSize - blockOffset) : size;
+
+        uint32_t column = blockOffset % _pageSize;
+        uint32_t pages = (column + run + _pageSize - 1) / _pageSize;
+        uint32_t row = _map.getPhysicalBlock(logicalBlock) * _pagesPerBlock +
+                       blockOffset / _pageSize;
+
+        /* first page into the data register */
+        result = loadPage(SPI_NAND_CMD_PAGE_READ, row);
+
+        for (uint32_t page = 0; (page < pages) && (result == NAND_SUCCESS); page++)
+        {
+            /* move page to cache and start loading the next one */
+            if (pages > 1)
+            {
+                uint8_t opcode = ((page + 1) < pages) ?
+                                 SPI_NAND_CMD_CACHE_READ_SEQ :
+                                 SPI_NAND_CMD_CACHE_READ_LAST;
+
+                result = loadPage(opcode, 0);
+            }
+
+            if (result == NAND_SUCCESS)
+            {
+                uint32_t length = ((_pageSize - column) < run) ?
+                                  (_pageSize - column) : run;
+
+                readCache(column, buffer, length);
+
+                buffer += length;
+                addr   += length;
+                size   -= length;
+                run    -= length;
+                column  = 0;
+            }
+        }
+    }
+
+    return (result == NAND_SUCCESS) ? BD_ERROR_OK : BD_ERROR_DEVICE_ERROR;
+}
+
+int SPINANDBlockDevice::program(const void* b, bd_addr_t addr, bd_size_t size)
+{
+    if ((!_initialized) || (addr + size > this->size()) ||
+        (addr % _pageSize) || (size % _pageSize))
+    {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    const uint8_t* buffer = (const uint8_t*) b;
+    const uint32_t blockSize = _pageSize * _pagesPerBlock;
+    int result = NAND_SUCCESS;
+
+    while ((size > 0) && (result == NAND_SUCCESS))
+    {
+        /* a page that fails moves the whole block to a spare */
+        result = _map.programPage(addr / blockSize,
+                                  (addr % blockSize) / _pageSize,
+                                  buffer);
+
+        buffer += _pageSize;
+        addr   += _pageSize;
+        size   -= _pageSize;
+    }
+
+    return (result == NAND_SUCCESS) ? BD_ERROR_OK : BD_ERROR_DEVICE_ERROR;
+}
+
+int SPINANDBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    const uint32_t blockSize = _pageSize * _pagesPerBlock;
+
+    if ((!_initialized) || (addr + size > this->size()) ||
+        (addr % blockSize) || (size % blockSize))
+    {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    int result = NAND_SUCCESS;
+
+    while ((size > 0) && (result == NAND_SUCCESS))
+    {
+        result = _map.eraseBlock(addr / blockSize);
+
+        addr += blockSize;
+        size -= blockSize;
+    }
+
+    return (result == NAND_SUCCESS) ? BD_ERROR_OK : BD_ERROR_DEVICE_ERROR;
+}
+
+bd_size_t SPINANDBlockDevice::get_read_size() const
+{
+    return 1;
+}
+
+bd_size_t SPINANDBlockDevice::get_program_size() const
+{
+    return _pageSize;
+}
+
+bd_size_t SPINANDBlockDevice::get_erase_size() const
+{
+    return _pageSize * _pagesPerBlock;
+}
+
+bd_size_t SPINANDBlockDevice::size() const
+{
+    return (bd_size_t) _map.getBlockCount() * _pagesPerBlock * _pageSize;
+}
+
+uint32_t SPINANDBlockDevice::get_bad_block_count() const
+{
+    return _map.getBadBlockCount();
+}
+
+int SPINANDBlockDevice::readPage(uint32_t row, uint32_t column,
+                                 uint8_t* buffer, uint32_t length)
+{
+    int result = loadPage(SPI_NAND_CMD_PAGE_READ, row);
+
+    if (result == NAND_SUCCESS)
+    {
+        readCache(column, buffer, length);
+    }
+
+    return result;
+}
+
+int SPINANDBlockDevice::programPage(uint32_t row, const uint8_t* buffer,
+                                    uint32_t length)
+{
+    int result = writeEnable();
+
+    if (result == NAND_SUCCESS)
+    {
+        loadProgram(0, buffer, length);
+
+        result = executeProgram(row);
+    }
+
+    return result;
+}
+
+/**
+ * Internal data move: page read into the cache, then program execute to
+ * the destination, ECC is corrected on read and regenerated on program.
+ */
+int SPINANDBlockDevice::copyPage(uint32_t sourceRow, uint32_t destinationRow)
+{
+    int result = loadPage(SPI_NAND_CMD_PAGE_READ, sourceRow);
+
+    if (result == NAND_SUCCESS)
+    {
+        result = writeEnable();
+    }
+
+    if (result == NAND_SUCCESS)
+    {
+        result = executeProgram(destinationRow);
+    }
+
+    return result;
+}
+
+int SPINANDBlockDevice::eraseBlock(uint32_t block)
+{
+    uint32_t row = block * _pagesPerBlock;
+    int result = writeEnable();
+
+    if (result == NAND_SUCCESS)
+    {
+        const uint8_t command[] = {
+            SPI_NAND_CMD_BLOCK_ERASE,
+            (uint8_t) (row >> 16), (uint8_t) (row >> 8), (uint8_t) row
+        };
+
+        writeCommand(command, sizeof(command));
+
+        uint8_t status = 0;
+        result = waitReady(&status);
+
+        if ((result == NAND_SUCCESS) && (status & SPI_NAND_STATUS_E_FAIL))
+        {
+            result = NAND_ERROR_WORN;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Read the first spare byte of the first page with ECC disabled, factory
+ * bad blocks may not hold valid ECC.
+ */
+int SPINANDBlockDevice::readBadBlockMarker(uint32_t block, bool* bad)
+{
+    int result = setECC(false);
+
+    if (result == NAND_SUCCESS)
+    {
+        result = loadPage(SPI_NAND_CMD_PAGE_READ, block * _pagesPerBlock);
+
+        if (result == NAND_SUCCESS)
+        {
+            uint8_t marker = 0;
+
+            readCache(_pageSize, &marker, sizeof(marker));
+
+            *bad = (marker != 0xFF);
+        }
+
+        int restored = setECC(true);
+
+        if (result == NAND_SUCCESS)
+        {
+            result = restored;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Program the first spare byte of the first page to zero, the load
+ * command leaves every other byte of the cache erased.
+ */
+int SPINANDBlockDevice::writeBadBlockMarker(uint32_t block)
+{
+    int result = setECC(false);
+
+    if (result == NAND_SUCCESS)
+    {
+        const uint8_t marker = 0x00;
+
+        result = writeEnable();
+
+        if (result == NAND_SUCCESS)
+        {
+            loadProgram(_pageSize, &marker, sizeof(marker));
+
+            result = executeProgram(block * _pagesPerBlock);
+        }
+
+        int restored = setECC(true);
+
+        if (result == NAND_SUCCESS)
+        {
+            result = restored;
+        }
+    }
+
+    return result;
+}
+
+void SPINANDBlockDevice::select()
+{
+    _spi.lock();
+    _cs = 0;
+}
+
+void SPINANDBlockDevice::deselect()
+{
+    _cs = 1;
+    _spi.unlock();
+}
+
+void SPINANDBlockDevice::writeCommand(const uint8_t* command, uint32_t length)
+{
+    select();
+    _spi.write((const char*) command, length, NULL, 0);
+    deselect();
+}
+
+int SPINANDBlockDevice::waitReady(uint8_t* status)
+{
+    uint8_t value = SPI_NAND_STATUS_OIP;
+
+    Timer timer;
+    timer.start();
+
+    while ((value & SPI_NAND_STATUS_OIP) &&
+           (timer.read_us() < SPI_NAND_TIMEOUT_US))
+    {
+        getFeature(SPI_NAND_FEATURE_STATUS, &value);
+    }
+
+    if (status)
+    {
+        *status = value;
+    }
+
+    return (value & SPI_NAND_STATUS_OIP) ? NAND_ERROR : NAND_SUCCESS;
+}
+
+int SPINANDBlockDevice::getFeature(uint8_t address, uint8_t* value)
+{
+    const uint8_t command[] = { SPI_NAND_CMD_GET_FEATURE, address };
+
+    select();
+    _spi.write((const char*) command, sizeof(command), NULL, 0);
+    *value = _spi.write(0xFF);
+    deselect();
+
+    return NAND_SUCCESS;
+}
+
+int SPINANDBlockDevice::setFeature(uint8_t address, uint8_t value)
+{
+    const uint8_t command[] = { SPI_NAND_CMD_SET_FEATURE, address, value };
+
+    writeCommand(command, sizeof(command));
+
+    return waitReady();
+}
+
+int SPINANDBlockDevice::setECC(bool enable)
+{
+    uint8_t config = 0;
+    int result = getFeature(SPI_NAND_FEATURE_CONFIG, &config);
+
+    if (result == NAND_SUCCESS)
+    {
+        config = enable ? (config | SPI_NAND_CONFIG_ECC_EN) :
+                          (config & ~SPI_NAND_CONFIG_ECC_EN);
+
+        result = setFeature(SPI_NAND_FEATURE_CONFIG, config);
+    }
+
+    return result;
+}
+
+int SPINANDBlockDevice::writeEnable()
+{
+    const uint8_t command = SPI_NAND_CMD_WRITE_ENABLE;
+
+    writeCommand(&command, sizeof(command));
+
+    return NAND_SUCCESS;
+}
+
+/**
+ * Issue a page read (with row address) or a cache read sequential/last
+ * (without) and wait for the array transfer to finish.
+ */
+int SPINANDBlockDevice::loadPage(uint8_t opcode, uint32_t row)
+{
+    if (opcode == SPI_NAND_CMD_PAGE_READ)
+    {
+        const uint8_t command[] = {
+            opcode, (uint8_t) (row >> 16), (uint8_t) (row >> 8), (uint8_t) row
+        };
+
+        writeCommand(command, sizeof(command));
+    }
+    else
+    {
+        writeCommand(&opcode, sizeof(opcode));
+    }
+
+    uint8_t status = 0;
+    int result = waitReady(&status);
+
+    /* on-die ECC could not correct the page */
+    if ((result == NAND_SUCCESS) &&
+        ((status & SPI_NAND_STATUS_ECC_MASK) == SPI_NAND_STATUS_ECC_FAIL))
+    {
+        result = NAND_ERROR;
+    }
+
+    return result;
+}
+
+/**
+ * Load data into the cache at column, the rest of the cache is reset to
+ * 0xFF so those bytes are not programmed.
+ */
+void SPINANDBlockDevice::loadProgram(uint16_t column, const uint8_t* buffer,
+                                     uint32_t length)
+{
+    const uint8_t command[] = {
+        SPI_NAND_CMD_PROGRAM_LOAD, (uint8_t) (column >> 8), (uint8_t) column
+    };
+
+    select();
+    _spi.write((const char*) command, sizeof(command), NULL, 0);
+    _spi.write((const char*) buffer, length, NULL, 0);
+    deselect();
+}
+
+int SPINANDBlockDevice::executeProgram(uint32_t row)
+{
+    const uint8_t command[] = {
+        SPI_NAND_CMD_PROGRAM_EXECUTE,
+        (uint8_t) (row >> 16), (uint8_t) (row >> 8), (uint8_t) row
+    };
+
+    writeCommand(command, sizeof(command));
+
+    uint8_t status = 0;
+    int result = waitReady(&status);
+
+    if ((result == NAND_SUCCESS) && (status & SPI_NAND_STATUS_P_FAIL))
+    {
+        result = NAND_ERROR_WORN;
+    }
+
+    return result;
+}
+
+void SPINANDBlockDevice::readCache(uint16_t column, uint8_t* buffer, uint32_t length)
+{
+    /* column address followed by one dummy byte */
+    const uint8_t command[] = {
+        SPI_NAND_CMD_READ_CACHE, (uint8_t) (column >> 8), (uint8_t) column, 0x00
+    };
+
+    select();
+    _spi.write((const char*) command, sizeof(command), NULL, 0);
+    _spi.write(NULL, 0, (char*) buffer, length);
+    deselect();
+}
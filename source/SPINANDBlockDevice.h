@@ -0,0 +1,107 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef SPI_NAND_BLOCK_DEVICE_H
+#define SPI_NAND_BLOCK_DEVICE_H
+
+#include "mbed.h"
+#include "BlockDevice.h"
+#include "NANDBlockMap.h"
+
+/**
+ * BlockDevice for raw SPI NAND flash with on-die ECC.
+ * @detail Bad blocks are handled by NANDBlockMap, which keeps a bad block
+ *         table in the top blocks of the die and replaces blocks that fail
+ *         to program or erase with spares from a reserve of
+ *         NAND_MAX_BAD_BLOCKS, so the device size does not depend on the
+ *         number of bad blocks. Reads spanning several pages use the
+ *         sequential cache read commands, which load the next page from
+ *         the array while the current one is clocked out.
+ *         The command set follows the common SPI NAND layout (13h page
+ *         read, 31h/3Fh cache read sequential/last, 03h read from cache,
+ *         ECC enable in bit 4 of feature register B0h).
+ */
+class SPINANDBlockDevice : public BlockDevice, private NANDArray
+{
+public:
+    /**
+     * @param mosi           SPI master out, slave in pin
+     * @param miso           SPI master in, slave out pin
+     * @param sclk           SPI clock pin
+     * @param cs             SPI chip select pin
+     * @param pageSize       Data bytes per page, without spare area
+     * @param pagesPerBlock  Pages per erase block
+     * @param blockCount     Number of erase blocks on the die
+     * @param hz             SPI clock frequency
+     */
+    SPINANDBlockDevice(PinName mosi, PinName miso, PinName sclk, PinName cs,
+                       uint32_t pageSize = 2048,
+                       uint32_t pagesPerBlock = 64,
+                       uint32_t blockCount = 1024,
+                       int hz = 20000000);
+
+    virtual int init();
+    virtual int deinit();
+    virtual int read(void* buffer, bd_addr_t addr, bd_size_t size);
+    virtual int program(const void* buffer, bd_addr_t addr, bd_size_t size);
+    virtual int erase(bd_addr_t addr, bd_size_t size);
+    virtual bd_size_t get_read_size() const;
+    virtual bd_size_t get_program_size() const;
+    virtual bd_size_t get_erase_size() const;
+    virtual bd_size_t size() const;
+
+    /**
+     * Number of factory and grown bad blocks.
+     */
+    uint32_t get_bad_block_count() const;
+
+private:
+    /* NANDArray */
+    virtual int readPage(uint32_t row, uint32_t column,
+                         uint8_t* buffer, uint32_t length);
+    virtual int programPage(uint32_t row, const uint8_t* buffer,
+                            uint32_t length);
+    virtual int copyPage(uint32_t sourceRow, uint32_t destinationRow);
+    virtual int eraseBlock(uint32_t block);
+    virtual int readBadBlockMarker(uint32_t block, bool* bad);
+    virtual int writeBadBlockMarker(uint32_t block);
+
+    void select();
+    void deselect();
+    void writeCommand(const uint8_t* command, uint32_t length);
+    int waitReady(uint8_t* status = NULL);
+    int getFeature(uint8_t address, uint8_t* value);
+    int setFeature(uint8_t address, uint8_t value);
+    int setECC(bool enable);
+    int writeEnable();
+    int loadPage(uint8_t opcode, uint32_t row);
+    void loadProgram(uint16_t column, const uint8_t* buffer, uint32_t length);
+    int executeProgram(uint32_t row);
+    void readCache(uint16_t column, uint8_t* buffer, uint32_t length);
+
+    SPI _spi;
+    DigitalOut _cs;
+
+    const uint32_t _pageSize;
+    const uint32_t _pagesPerBlock;
+
+    NANDBlockMap _map;
+    bool _initialized;
+};
+
+#endif // SPI_NAND_BLOCK_DEVICE_H
@@ -22,6 +22,10 @@
 
 #include "active_application.h"
 #include "bootloader_common.h"
+#include "image_record.h"
+#include "flash_geometry.h"
+#include "blake2s.h"
+#include "erase_counter.h"
 
 #include "update-client-common/arm_uc_metadata_header_v2.h"
 #include "update-client-common/arm_uc_utilities.h"
@@ -31,12 +35,53 @@
 
 #include <inttypes.h>
 
+#if defined(MBED_CONF_APP_FLASH_PAGE_SIZE) && defined(MBED_CONF_APP_FLASH_SECTOR_SIZE)
+/* with a fixed geometry the layout is checked when compiling */
+#if (FIRMWARE_METADATA_HEADER_ADDRESS % MBED_CONF_APP_FLASH_SECTOR_SIZE) != 0
+#error "update-client.application-details must be aligned to flash-sector-size"
+#endif
+
+#if (MBED_CONF_APP_APPLICATION_START_ADDRESS % MBED_CONF_APP_FLASH_PAGE_SIZE) != 0
+#error "application-start-address must be aligned to flash-page-size"
+#endif
+#endif
+
 static FlashIAP flash;
+static const ActiveFlashGeometry geometry(flash);
 
 bool activeStorageInit(void)
 {
     int rc = flash.init();
 
+    /* configured geometry must match the part across the whole region the
+       header and application are erased and programmed in */
+    if (rc == 0)
+    {
+        /* coverity[no_escape] */
+        MBED_BOOTLOADER_ASSERT(geometry.getPageSize() == flash.get_page_size(),
+            "Configured flash page size does not match FlashIAP\r\n");
+
+        for (uint32_t address = FIRMWARE_METADATA_HEADER_ADDRESS;
+             address < (MBED_CONF_APP_APPLICATION_START_ADDRESS +
+                        MBED_CONF_APP_MAX_APPLICATION_SIZE);
+             address += flash.get_sector_size(address))
+        {
+            /* coverity[no_escape] */
+            MBED_BOOTLOADER_ASSERT(
+                geometry.getSectorSize(address) == flash.get_sector_size(address),
+                "Configured flash sector size does not match FlashIAP "
+                "at 0x%08" PRIX32 "\r\n", address);
+        }
+
+#if ERASE_COUNTER_ENABLED
+        /* wear tracking is not required for booting */
+        if (!eraseCounterInit(&flash))
+        {
+            tr_warning("Erase counters unavailable");
+        }
+#endif
+    }
+
     return (rc == 0);
 }
 
@@ -87,6 +132,262 @@ bool readActiveFirmwareHeader(arm_uc_firmware_details_t* details)
     return result;
 }
 
+/* verified-image record of the active application, word aligned */
+static uint32_t record_array[IMAGE_RECORD_MAX_SIZE / sizeof(uint32_t)];
+static image_record_t* const record = (image_record_t*) record_array;
+static image_record_checkpoint_t* const checkpoints =
+    (image_record_checkpoint_t*) (record + 1);
+
+/**
+ * Repair block digests, located after the checkpoint array.
+ */
+static uint32_t* getRepairDigests(void)
+{
+    return (uint32_t*) (checkpoints + record->checkpointCount);
+}
+
+/**
+ * Size in bytes of the record currently held in RAM.
+ */
+static uint32_t getImageRecordSize(void)
+{
+    return sizeof(image_record_t) +
+           record->checkpointCount * sizeof(image_record_checkpoint_t) +
+           record->repairBlockCount * sizeof(uint32_t);
+}
+
+/**
+ * Address of the verified-image record, on the first page after the header.
+ */
+static uint32_t getImageRecordAddress(void)
+{
+    return FIRMWARE_METADATA_HEADER_ADDRESS +
+           geometry.roundUpToPage(ARM_UC_INTERNAL_HEADER_SIZE_V2);
+}
+
+/**
+ * Number of bytes available for the verified-image record.
+ */
+static uint32_t getImageRecordCapacity(void)
+{
+    uint32_t used = getImageRecordAddress() - FIRMWARE_METADATA_HEADER_ADDRESS;
+    uint32_t capacity = 0;
+
+    if (FIRMWARE_METADATA_HEADER_SIZE > used)
+    {
+        capacity = FIRMWARE_METADATA_HEADER_SIZE - used;
+    }
+
+    if (capacity > sizeof(record_array))
+    {
+        capacity = sizeof(record_array);
+    }
+
+    return capacity;
+}
+
+/**
+ * CRC of the record in RAM, computed with the crc field set to zero.
+ */
+static uint32_t getImageRecordCRC(uint32_t recordSize)
+{
+    uint32_t stored = record->crc;
+
+    record->crc = 0;
+    uint32_t crc = arm_uc_crc32((const uint8_t*) record_array, recordSize);
+    record->crc = stored;
+
+    return crc;
+}
+
+/**
+ * End address of the repair block starting at address.
+ */
+static uint32_t getRepairBlockEnd(uint32_t address, uint32_t sectorsPerBlock)
+{
+    for (uint32_t index = 0; index < sectorsPerBlock; index++)
+    {
+        address += geometry.getSectorSize(address);
+    }
+
+    return address;
+}
+
+/**
+ * Read the verified-image record from internal flash into RAM
+ * @param  details
+ *             Header of the active image the record must belong to.
+ * @return true if the record is intact and matches the active image.
+ */
+static bool readActiveImageRecord(const arm_uc_firmware_details_t* details)
+{
+    const uint32_t address = getImageRecordAddress();
+    const uint32_t capacity = getImageRecordCapacity();
+
+    if (capacity < sizeof(image_record_t))
+    {
+        return false;
+    }
+
+    int status = flash.read(record_array, address, sizeof(image_record_t));
+
+    /* bound each count separately before summing them */
+    const uint32_t entries = (capacity - sizeof(image_record_t)) / sizeof(uint32_t);
+
+    if ((status != 0) ||
+        (record->magic != IMAGE_RECORD_MAGIC) ||
+        (record->version != IMAGE_RECORD_VERSION) ||
+        (record->checkpointInterval != IMAGE_RECORD_CHECKPOINT_INTERVAL) ||
+        (record->imageSize != details->size) ||
+        (memcmp(record->imageHash, details->hash, SIZEOF_SHA256) != 0) ||
+        (record->checkpointCount > entries) ||
+        (record->repairBlockCount > entries) ||
+        (getImageRecordSize() > capacity))
+    {
+        return false;
+    }
+
+    uint32_t recordSize = getImageRecordSize();
+
+    status = flash.read(checkpoints,
+                        address + sizeof(image_record_t),
+                        recordSize - sizeof(image_record_t));
+
+    return ((status == 0) && (getImageRecordCRC(recordSize) == record->crc));
+}
+
+/**
+ * Program the record in RAM into the erased metadata header region.
+ */
+static bool programActiveImageRecord(void)
+{
+    const uint32_t recordSize = getImageRecordSize();
+    const uint32_t programSize = geometry.roundUpToPage(recordSize);
+
+    if (programSize > getImageRecordCapacity())
+    {
+        return false;
+    }
+
+    /* pad to page size */
+    memset(((uint8_t*) record_array) + recordSize, 0xFF,
+           programSize - recordSize);
+
+    int status = flash.program(record_array, getImageRecordAddress(), programSize);
+    ENERGY_COUNT(flashProgram, programSize);
+    ENERGY_COUNT(flashProgramCalls, 1);
+
+    return (status == 0);
+}
+
+/**
+ * Program the verified-image record built in RAM into internal flash
+ * @detail The caller fills in the checkpoints, digests and their counts.
+ *         The record is only written to an erased region, i.e., once per
+ *         installed image.
+ * @param  details
+ *             Header of the verified active image.
+ * @return true if the record was written.
+ */
+static bool writeActiveImageRecord(const arm_uc_firmware_details_t* details)
+{
+    tr_debug("writeActiveImageRecord");
+
+    const uint32_t recordSize = getImageRecordSize();
+    const uint32_t programSize = geometry.roundUpToPage(recordSize);
+
+    if (programSize > getImageRecordCapacity())
+    {
+        return false;
+    }
+
+    /* refuse to program on top of an old or partially written record */
+    int status = flash.read(buffer_array, getImageRecordAddress(), programSize);
+
+    for (uint32_t index = 0; (index < programSize) && (status == 0); index++)
+    {
+        if (buffer_array[index] != 0xFF)
+        {
+            status = -1;
+        }
+    }
+
+    bool result = false;
+
+    if (status == 0)
+    {
+        record->magic = IMAGE_RECORD_MAGIC;
+        record->version = IMAGE_RECORD_VERSION;
+        record->imageSize = details->size;
+        record->checkpointInterval = IMAGE_RECORD_CHECKPOINT_INTERVAL;
+        memcpy(record->imageHash, details->hash, SIZEOF_SHA256);
+        record->crc = getImageRecordCRC(recordSize);
+
+        result = programActiveImageRecord();
+    }
+
+    return result;
+}
+
+/**
+ * Plan the layout of a new verified-image record in RAM
+ * @detail Reserve one checkpoint per interval, as far as space permits, and
+ *         use the remaining space for repair block digests. Sectors are
+ *         grouped into repair blocks until the digests fit.
+ * @param  imageSize
+ *             Size of the active image.
+ */
+static void planActiveImageRecord(uint32_t imageSize)
+{
+    const uint32_t capacity = getImageRecordCapacity();
+    const uint32_t imageEnd = MBED_CONF_APP_APPLICATION_START_ADDRESS + imageSize;
+
+    record->checkpointCount = 0;
+    record->sectorsPerBlock = 0;
+    record->repairBlockCount = 0;
+    record->digestType = IMAGE_RECORD_DIGEST;
+    memset(record->digest, 0, sizeof(record->digest));
+
+    if (capacity <= sizeof(image_record_t))
+    {
+        return;
+    }
+
+    uint32_t space = capacity - sizeof(image_record_t);
+
+#if !defined(MBEDTLS_SHA256_ALT)
+    /* hardware accelerated contexts do not expose the midstate */
+    uint32_t checkpointCount = (imageSize - 1) / IMAGE_RECORD_CHECKPOINT_INTERVAL;
+
+    if (checkpointCount > space / sizeof(image_record_checkpoint_t))
+    {
+        checkpointCount = space / sizeof(image_record_checkpoint_t);
+    }
+
+    record->checkpointCount = checkpointCount;
+    space -= checkpointCount * sizeof(image_record_checkpoint_t);
+#endif
+
+    /* count sectors spanned by header and image */
+    uint32_t sectorCount = 0;
+    uint32_t address = FIRMWARE_METADATA_HEADER_ADDRESS;
+
+    while (address < imageEnd)
+    {
+        address += geometry.getSectorSize(address);
+        sectorCount++;
+    }
+
+    uint32_t digestMax = space / sizeof(uint32_t);
+
+    if (digestMax > 0)
+    {
+        record->sectorsPerBlock = (sectorCount + digestMax - 1) / digestMax;
+        record->repairBlockCount = (sectorCount + record->sectorsPerBlock - 1)
+                                   / record->sectorsPerBlock;
+    }
+}
+
 /**
  * Verify the integrity of the Active application
  * @detail Read the firmware in the ACTIVE app region and compute its hash.
@@ -101,7 +402,30 @@ bool readActiveFirmwareHeader(arm_uc_firmware_details_t* details)
  */
 int checkActiveApplication(arm_uc_firmware_details_t* details)
 {
-    tr_debug("checkActiveApplication");
+    return checkActiveApplicationFrom(details, 0);
+}
+
+/**
+ * Verify the integrity of the Active application, reusing the hash of
+ * the unmodified part of the image
+ * @detail Resume hashing from the last checkpoint at or before
+ *         modifiedOffset in the verified-image record. Without a valid
+ *         record the full image is hashed, and a new record is written
+ *         if the image turns out to be valid.
+ * @param  headerP
+ *             Caller-allocated header structure containing the hash and size
+ *             of the firmware.
+ * @param  modifiedOffset
+ *             Offset in the image of the first byte that may have changed
+ *             since the image was last verified.
+ * @return SUCCESS if the validation succeeds
+ *         EMPTY   if no active application is present
+ *         ERROR   if the validation fails
+ */
+int checkActiveApplicationFrom(arm_uc_firmware_details_t* details,
+                               uint32_t modifiedOffset)
+{
+    tr_debug("checkActiveApplicationFrom");
 
     int result = RESULT_ERROR;
 
@@ -125,49 +449,201 @@ int checkActiveApplication(arm_uc_firmware_details_t* details)
             mbedtls_sha256_init(&mbedtls_ctx);
             mbedtls_sha256_starts(&mbedtls_ctx, 0);
 
+#if BLAKE2S_ENABLED
+            /* alternative digest declared by the record */
+            blake2s_context blake2s_ctx;
+            blake2s_starts(&blake2s_ctx);
+#endif
+
             uint8_t SHA[SIZEOF_SHA256] = { 0 };
-            uint32_t remaining = details->size;
+            uint32_t offset = 0;
             int32_t status = 0;
 
-            /* read full image */
-            while ((remaining > 0) && (status == 0))
+            /* build a new record while hashing if none exists */
+            bool buildRecord = !readActiveImageRecord(details);
+
+            /* full checks use the digest in the record when it has one,
+               without BLAKE2s compiled in the SHA-256 from the header is used */
+#if BLAKE2S_ENABLED
+            bool fastDigest = (!buildRecord) &&
+                              (modifiedOffset == 0) &&
+                              (record->digestType == IMAGE_RECORD_DIGEST_BLAKE2S);
+#endif
+
+            if (buildRecord)
+            {
+                planActiveImageRecord(details->size);
+            }
+            else
+            {
+                uint32_t resume = modifiedOffset / IMAGE_RECORD_CHECKPOINT_INTERVAL;
+
+                if (resume > record->checkpointCount)
+                {
+                    resume = record->checkpointCount;
+                }
+
+#if !defined(MBEDTLS_SHA256_ALT)
+                /* restore midstate at the end of checkpoint interval 'resume' */
+                if (resume > 0)
+                {
+                    memcpy(mbedtls_ctx.state,
+                           checkpoints[resume - 1].state,
+                           sizeof(mbedtls_ctx.state));
+
+                    offset = resume * IMAGE_RECORD_CHECKPOINT_INTERVAL;
+                    mbedtls_ctx.total[0] = offset;
+                    mbedtls_ctx.total[1] = 0;
+
+                    tr_debug("resume hash at offset %" PRIu32, offset);
+                }
+#endif
+            }
+
+            /* repair block being digested, only used when building */
+            uint32_t* digests = getRepairDigests();
+            uint32_t blockIndex = 0;
+            uint32_t blockCRC = 0;
+            uint32_t blockEnd = FIRMWARE_METADATA_HEADER_ADDRESS;
+
+            if (buildRecord && (record->repairBlockCount > 0))
+            {
+                blockEnd = getRepairBlockEnd(FIRMWARE_METADATA_HEADER_ADDRESS,
+                                             record->sectorsPerBlock);
+            }
+
+            /* read remaining image */
+            while ((offset < details->size) && (status == 0))
             {
                 /* read full buffer or what is remaining */
-                uint32_t readSize = (remaining > BUFFER_SIZE) ?
-                                    BUFFER_SIZE : remaining;
+                uint32_t readSize = ((details->size - offset) > BUFFER_SIZE) ?
+                                    BUFFER_SIZE : (details->size - offset);
+
+                if (buildRecord)
+                {
+                    /* stop on the next checkpoint boundary */
+                    uint32_t boundary = (offset / IMAGE_RECORD_CHECKPOINT_INTERVAL + 1)
+                                        * IMAGE_RECORD_CHECKPOINT_INTERVAL;
+
+                    if (readSize > (boundary - offset))
+                    {
+                        readSize = boundary - offset;
+                    }
+
+                    if (record->repairBlockCount > 0)
+                    {
+                        /* store digests of completed repair blocks */
+                        while ((blockEnd <= appStart + offset) &&
+                               (blockIndex < record->repairBlockCount))
+                        {
+                            digests[blockIndex++] = blockCRC;
+                            blockCRC = 0;
+                            blockEnd = getRepairBlockEnd(blockEnd,
+                                                         record->sectorsPerBlock);
+                        }
+
+                        /* stop on the next repair block boundary */
+                        if (readSize > (blockEnd - (appStart + offset)))
+                        {
+                            readSize = blockEnd - (appStart + offset);
+                        }
+                    }
+                }
 
                 /* read buffer using FlashIAP API for portability */
-                status = flash.read(buffer_array,
-                                    appStart + (details->size - remaining),
-                                    readSize);
+                status = flash.read(buffer_array, appStart + offset, readSize);
 
                 /* update hash */
-                mbedtls_sha256_update(&mbedtls_ctx, buffer_array, readSize);
+#if BLAKE2S_ENABLED
+                if (fastDigest)
+                {
+                    blake2s_update(&blake2s_ctx, buffer_array, readSize);
+                    ENERGY_COUNT(blake2s, readSize);
+                }
+                else
+#endif
+                {
+                    mbedtls_sha256_update(&mbedtls_ctx, buffer_array, readSize);
+                    ENERGY_COUNT(sha256, readSize);
+                }
+
+                /* update offset */
+                offset += readSize;
 
-                /* update remaining bytes */
-                remaining -= readSize;
+                if (buildRecord)
+                {
+#if IMAGE_RECORD_DIGEST == IMAGE_RECORD_DIGEST_BLAKE2S
+                    blake2s_update(&blake2s_ctx, buffer_array, readSize);
+                    ENERGY_COUNT(blake2s, readSize);
+#endif
+                    blockCRC = crc32Update(blockCRC, buffer_array, readSize);
+
+#if !defined(MBEDTLS_SHA256_ALT)
+                    /* save midstate, the image end is not a useful checkpoint */
+                    uint32_t index = offset / IMAGE_RECORD_CHECKPOINT_INTERVAL;
+
+                    if ((offset % IMAGE_RECORD_CHECKPOINT_INTERVAL == 0) &&
+                        (index <= record->checkpointCount) &&
+                        (offset < details->size))
+                    {
+                        memcpy(checkpoints[index - 1].state,
+                               mbedtls_ctx.state,
+                               sizeof(mbedtls_ctx.state));
+                    }
+#endif
+                }
 
 #if defined(SHOW_PROGRESS_BAR) && SHOW_PROGRESS_BAR == 1
-                printProgress(details->size - remaining,
-                              details->size);
+                printProgress(offset, details->size);
 #endif
             }
 
+            /* store digest of the last repair block */
+            if (buildRecord && (blockIndex < record->repairBlockCount))
+            {
+                digests[blockIndex++] = blockCRC;
+            }
+
             /* finalize hash */
             mbedtls_sha256_finish(&mbedtls_ctx, SHA);
             mbedtls_sha256_free(&mbedtls_ctx);
 
             /* compare calculated hash with hash from header */
-            int diff = memcmp(details->hash, SHA, SIZEOF_SHA256);
+            const uint8_t* expected = details->hash;
+            const char* digestName = "SHA256";
+
+#if BLAKE2S_ENABLED
+            if (fastDigest)
+            {
+                /* compare calculated digest with digest from record */
+                blake2s_finish(&blake2s_ctx, SHA);
+                expected = record->digest;
+                digestName = "BLAKE2s";
+            }
+#endif
+
+            int diff = memcmp(expected, SHA, SIZEOF_SHA256);
 
             if (diff == 0)
             {
                 result = RESULT_SUCCESS;
+
+                if (buildRecord && (status == 0) &&
+                    (blockIndex == record->repairBlockCount))
+                {
+#if IMAGE_RECORD_DIGEST == IMAGE_RECORD_DIGEST_BLAKE2S
+                    blake2s_finish(&blake2s_ctx, record->digest);
+#endif
+                    bool written = writeActiveImageRecord(details);
+
+                    tr_debug("image record written: %d", written);
+                    (void) written;
+                }
             }
             else
             {
-                printSHA256(details->hash);
-                printSHA256(SHA);
+                printDigest(digestName, expected);
+                printDigest(digestName, SHA);
             }
         }
         else if ((headerValid) && (details->size == 0))
@@ -180,6 +656,47 @@ int checkActiveApplication(arm_uc_firmware_details_t* details)
     return result;
 }
 
+/**
+ * Erase internal flash sector by sector
+ * @detail With a fixed geometry the sector walk adds a constant.
+ * @param  start
+ *             Sector aligned start address.
+ * @param  end
+ *             Erase all sectors that begin before this address.
+ * @return true if the erase succeeds.
+ */
+static bool eraseActiveSectors(uint32_t start, uint32_t end)
+{
+    /* Erasing sector by sector as some platforms have varible sector sizes
+       and mbed-os cannot deal with erasing multiple sectors successfully in
+       that case. https://github.com/ARMmbed/mbed-os/issues/6077 */
+    int result = 0;
+    uint32_t erase_address = start;
+
+    while ((erase_address < end) && (result == 0))
+    {
+        uint32_t sector_size = geometry.getSectorSize(erase_address);
+
+        /* count before erasing, a lost count is worse than an extra one */
+        eraseCounterRecord(erase_address);
+        ENERGY_COUNT(flashErase, 1);
+
+        result = flash.erase(erase_address,
+                             sector_size);
+        if (result != 0)
+        {
+            tr_debug("Erasing from 0x%08" PRIX32 " to 0x%08" PRIX32 " failed with retval %i",
+                     erase_address, erase_address + sector_size, result);
+        }
+        else
+        {
+            erase_address += sector_size;
+        }
+    }
+
+    return (result == 0);
+}
+
 /**
  * Wipe the ACTIVE firmware region in the flash
  */
@@ -193,11 +710,11 @@ bool eraseActiveFirmware(uint32_t firmwareSize)
     uint32_t size_needed = FIRMWARE_METADATA_HEADER_SIZE + firmwareSize;
     while (erase_address < (FIRMWARE_METADATA_HEADER_ADDRESS + size_needed))
     {
-        erase_address += flash.get_sector_size(erase_address);
+        erase_address += geometry.getSectorSize(erase_address);
     }
 
     /* check that the erase will not exceed MBED_CONF_APP_MAX_APPLICATION_SIZE */
-    int result = -1;
+    bool result = false;
     if (erase_address < (MBED_CONF_APP_MAX_APPLICATION_SIZE + \
                          MBED_CONF_APP_APPLICATION_START_ADDRESS))
     {
@@ -205,26 +722,9 @@ bool eraseActiveFirmware(uint32_t firmwareSize)
                  (uint32_t) FIRMWARE_METADATA_HEADER_ADDRESS,
                  (uint32_t) erase_address);
 
-        /* Erase flash to make place for new application. Erasing sector by sector as some
-           platforms have varible sector sizes and mbed-os cannot deal with erasing multiple
-           sectors successfully in that case. https://github.com/ARMmbed/mbed-os/issues/6077 */
-        erase_address = FIRMWARE_METADATA_HEADER_ADDRESS;
-        while (erase_address < (FIRMWARE_METADATA_HEADER_ADDRESS + size_needed))
-        {
-            uint32_t sector_size = flash.get_sector_size(erase_address);
-            result = flash.erase(erase_address,
-                                 sector_size);
-            if (result != 0)
-            {
-                tr_debug("Erasing from 0x%08" PRIX32 " to 0x%08" PRIX32 " failed with retval %i",
-                         erase_address, erase_address + sector_size, result);
-                break;
-            }
-            else
-            {
-                erase_address += sector_size;
-            }
-        }
+        /* Erase flash to make place for new application. */
+        result = eraseActiveSectors(FIRMWARE_METADATA_HEADER_ADDRESS,
+                                    FIRMWARE_METADATA_HEADER_ADDRESS + size_needed);
     }
     else
     {
@@ -234,7 +734,7 @@ bool eraseActiveFirmware(uint32_t firmwareSize)
                  MBED_CONF_APP_MAX_APPLICATION_SIZE);
     }
 
-    return (result == 0);
+    return result;
 }
 
 bool writeActiveFirmwareHeader(arm_uc_firmware_details_t* details)
@@ -246,9 +746,8 @@ bool writeActiveFirmwareHeader(arm_uc_firmware_details_t* details)
     if (details)
     {
         /* round up program size to nearest page size */
-        const uint32_t pageSize = flash.get_page_size();
-        const uint32_t programSize = (ARM_UC_INTERNAL_HEADER_SIZE_V2 + pageSize - 1)
-                                     / pageSize * pageSize;
+        const uint32_t programSize =
+            geometry.roundUpToPage(ARM_UC_INTERNAL_HEADER_SIZE_V2);
 
         /* coverity[no_escape] */
         MBED_BOOTLOADER_ASSERT((programSize <= BUFFER_SIZE),
@@ -280,6 +779,8 @@ bool writeActiveFirmwareHeader(arm_uc_firmware_details_t* details)
             int ret = flash.program(buffer_array,
                                     FIRMWARE_METADATA_HEADER_ADDRESS,
                                     programSize);
+            ENERGY_COUNT(flashProgram, programSize);
+            ENERGY_COUNT(flashProgramCalls, 1);
 
             result = (ret == 0);
         }
@@ -288,15 +789,32 @@ bool writeActiveFirmwareHeader(arm_uc_firmware_details_t* details)
     return result;
 }
 
-bool writeActiveFirmware(uint32_t index, arm_uc_firmware_details_t* details)
+/**
+ * Copy part of a stored firmware into the erased ACTIVE region
+ * @detail With a fixed geometry the page size, the alignment check and the
+ *         rounding of the last page are constants.
+ * @param  index
+ *             Index of the stored firmware.
+ * @param  details
+ *             Header of the stored firmware.
+ * @param  start
+ *             Page aligned offset in the image of the first byte to copy.
+ * @param  end
+ *             Offset in the image after the last byte to copy.
+ * @return true if the copy succeeds.
+ */
+static bool writeActiveFirmwareRange(uint32_t index,
+                                     arm_uc_firmware_details_t* details,
+                                     uint32_t start,
+                                     uint32_t end)
 {
-    tr_debug("writeActiveFirmware");
+    tr_debug("writeActiveFirmwareRange");
 
     bool result = false;
 
     if (details)
     {
-        const uint32_t pageSize = flash.get_page_size();
+        const uint32_t pageSize = geometry.getPageSize();
 
         /* we require app_start_addr fall on a page size boundary */
         uint32_t app_start_addr = MBED_CONF_APP_APPLICATION_START_ADDRESS;
@@ -320,18 +838,18 @@ bool writeActiveFirmware(uint32_t index, arm_uc_firmware_details_t* details)
         };
 
         int retval = 0;
-        uint32_t offset = 0;
+        uint32_t offset = start;
 
         /* write firmware */
-        while ((offset < details->size) &&
+        while ((offset < end) &&
                (retval == 0))
         {
             /* clear most recent UCP event */
             event_callback = CLEAR_EVENT;
 
             /* set the number of bytes expected */
-            buffer.size = (details->size - offset) > buffer.size_max ?
-                            buffer.size_max : (details->size - offset);
+            buffer.size = (end - offset) > buffer.size_max ?
+                            buffer.size_max : (end - offset);
 
             /* fill buffer using UCP */
             arm_uc_error_t ucp_status = ARM_UCP_Read(index, offset, &buffer);
@@ -349,12 +867,14 @@ bool writeActiveFirmware(uint32_t index, arm_uc_firmware_details_t* details)
             if ((event_callback == ARM_UC_PAAL_EVENT_READ_DONE) &&
                 (buffer.size > 0))
             {
+                ENERGY_COUNT(storageRead, buffer.size);
+                ENERGY_COUNT(storageReadCalls, 1);
+
                 /* the last page, in the last buffer might not be completely
                    filled, round up the program size to include the last page
                 */
                 uint32_t programOffset = 0;
-                uint32_t programSize = (buffer.size + pageSize - 1)
-                                       / pageSize * pageSize;
+                uint32_t programSize = geometry.roundUpToPage(buffer.size);
 
                 /* write one page at a time */
                 while ((programOffset < programSize) &&
@@ -363,6 +883,8 @@ bool writeActiveFirmware(uint32_t index, arm_uc_firmware_details_t* details)
                     retval = flash.program(&(buffer.ptr[programOffset]),
                                            app_start_addr + offset + programOffset,
                                            pageSize);
+                    ENERGY_COUNT(flashProgram, pageSize);
+                    ENERGY_COUNT(flashProgramCalls, 1);
 
                     programOffset += pageSize;
 
@@ -392,6 +914,129 @@ bool writeActiveFirmware(uint32_t index, arm_uc_firmware_details_t* details)
     return result;
 }
 
+bool writeActiveFirmware(uint32_t index, arm_uc_firmware_details_t* details)
+{
+    tr_debug("writeActiveFirmware");
+
+    bool result = false;
+
+    if (details)
+    {
+        result = writeActiveFirmwareRange(index, details, 0, details->size);
+    }
+
+    return result;
+}
+
+/**
+ * Rewrite only the corrupt sectors of the ACTIVE application
+ * @detail Compare each repair block of the active image with its digest in
+ *         the verified-image record and copy the blocks that differ from a
+ *         stored firmware holding the same image. The block digests are
+ *         CRC-32, so the whole image is hashed again before it is accepted.
+ * @param  index
+ *             Index of the stored firmware.
+ * @param  details
+ *             Header of the stored firmware.
+ * @return true if the active image was repaired and is valid.
+ */
+static bool repairActiveFirmware(uint32_t index,
+                                 arm_uc_firmware_details_t* details)
+{
+    tr_debug("repairActiveFirmware");
+
+    arm_uc_firmware_details_t activeDetails = {
+        .version  = 0,
+        .size     = 0,
+        .hash     = { 0 },
+        .campaign = { 0 }
+    };
+
+    /* only an image identical to the stored one can be repaired */
+    if ((!readActiveFirmwareHeader(&activeDetails)) ||
+        (activeDetails.size != details->size) ||
+        (memcmp(activeDetails.hash, details->hash, SIZEOF_SHA256) != 0) ||
+        (!readActiveImageRecord(&activeDetails)) ||
+        (record->repairBlockCount == 0))
+    {
+        return false;
+    }
+
+    const uint32_t appStart = MBED_CONF_APP_APPLICATION_START_ADDRESS;
+    const uint32_t appEnd = appStart + details->size;
+    const uint32_t* digests = getRepairDigests();
+
+    bool result = true;
+    bool repaired = false;
+    uint32_t blockStart = FIRMWARE_METADATA_HEADER_ADDRESS;
+
+    for (uint32_t block = 0; (block < record->repairBlockCount) && result; block++)
+    {
+        uint32_t blockEnd = getRepairBlockEnd(blockStart, record->sectorsPerBlock);
+
+        /* image bytes inside the block */
+        uint32_t start = (blockStart > appStart) ? blockStart : appStart;
+        uint32_t end = (blockEnd < appEnd) ? blockEnd : appEnd;
+
+        uint32_t blockCRC = 0;
+        int status = 0;
+
+        for (uint32_t address = start; (address < end) && (status == 0); )
+        {
+            uint32_t readSize = ((end - address) > BUFFER_SIZE) ?
+                                BUFFER_SIZE : (end - address);
+
+            status = flash.read(buffer_array, address, readSize);
+            blockCRC = crc32Update(blockCRC, buffer_array, readSize);
+
+            address += readSize;
+        }
+
+        if ((status != 0) || (blockCRC != digests[block]))
+        {
+            tr_info("Repair active firmware from 0x%08" PRIX32 " to 0x%08" PRIX32,
+                    blockStart, blockEnd);
+
+            result = eraseActiveSectors(blockStart, blockEnd);
+
+            /* the first block also holds the header and the record */
+            if (result && (blockStart == FIRMWARE_METADATA_HEADER_ADDRESS))
+            {
+                result = writeActiveFirmwareHeader(&activeDetails) &&
+                         programActiveImageRecord();
+            }
+
+            if (result && (start < end))
+            {
+                result = writeActiveFirmwareRange(index,
+                                                  details,
+                                                  start - appStart,
+                                                  end - appStart);
+            }
+
+            repaired = true;
+        }
+
+        blockStart = blockEnd;
+    }
+
+    /* nothing to repair if every block matches its digest */
+    if (result && repaired)
+    {
+        tr_info("Verify repaired active firmware:");
+
+        int recheck = checkActiveApplication(&activeDetails);
+
+        result = (recheck == RESULT_SUCCESS);
+    }
+    else
+    {
+        result = false;
+    }
+
+    return result;
+}
+
 /*
  * Copy loop to update the application
  */
@@ -402,6 +1047,17 @@ bool copyStoredApplication(uint32_t index,
 
     bool result = false;
 
+    /*************************************************************************/
+    /* Step 0. Repair active application if it holds the same image         */
+    /*************************************************************************/
+
+    if (repairActiveFirmware(index, details))
+    {
+        tr_info("Active firmware repaired");
+
+        return true;
+    }
+
     /*************************************************************************/
     /* Step 1. Erase active application                                      */
     /*************************************************************************/
@@ -45,4 +45,23 @@ bool readActiveFirmwareHeader(arm_uc_firmware_details_t* details);
  */
 int checkActiveApplication(arm_uc_firmware_details_t* details);
 
+/**
+ * Verify the integrity of the Active application, reusing the hash of
+ * the unmodified part of the image
+ * @detail Resume hashing from the last SHA-256 checkpoint at or before
+ *         modifiedOffset in the verified-image record. Without a valid
+ *         record the full image is hashed.
+ * @param  headerP
+ *             Caller-allocated header structure containing the hash and size
+ *             of the firmware.
+ * @param  modifiedOffset
+ *             Offset in the image of the first byte that may have changed
+ *             since the image was last verified.
+ * @return SUCCESS if the validation succeeds
+ *         EMPTY   if no active application is present
+ *         ERROR   if the validation fails
+ */
+int checkActiveApplicationFrom(arm_uc_firmware_details_t* details,
+                               uint32_t modifiedOffset);
+
 bool copyStoredApplication(uint32_t index, arm_uc_firmware_details_t* details);
@@ -0,0 +1,193 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "blake2s.h"
+
+#if BLAKE2S_ENABLED
+
+#include <string.h>
+
+static const uint32_t blake2s_iv[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+static const uint8_t blake2s_sigma[10][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+#define G(a, b, c, d, x, y)          \
+    do {                             \
+        a = a + b + (x);             \
+        d = ROTR32(d ^ a, 16);       \
+        c = c + d;                   \
+        b = ROTR32(b ^ c, 12);       \
+        a = a + b + (y);             \
+        d = ROTR32(d ^ a, 8);        \
+        c = c + d;                   \
+        b = ROTR32(b ^ c, 7);        \
+    } while (0)
+
+static uint32_t load32(const uint8_t* p)
+{
+    return ((uint32_t) p[0])       | ((uint32_t) p[1] << 8) |
+           ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void blake2s_compress(blake2s_context* ctx,
+                             const uint8_t block[BLAKE2S_BLOCK_SIZE],
+                             uint32_t last)
+{
+    uint32_t m[16];
+    uint32_t v[16];
+
+    for (uint32_t index = 0; index < 16; index++)
+    {
+        m[index] = load32(&block[4 * index]);
+    }
+
+    for (uint32_t index = 0; index < 8; index++)
+    {
+        v[index] = ctx->h[index];
+        v[index + 8] = blake2s_iv[index];
+    }
+
+    v[12] ^= ctx->t[0];
+    v[13] ^= ctx->t[1];
+
+    if (last)
+    {
+        v[14] = ~v[14];
+    }
+
+    for (uint32_t round = 0; round < 10; round++)
+    {
+        const uint8_t* s = blake2s_sigma[round];
+
+        G(v[0], v[4], v[ 8], v[12], m[s[ 0]], m[s[ 1]]);
+        G(v[1], v[5], v[ 9], v[13], m[s[ 2]], m[s[ 3]]);
+        G(v[2], v[6], v[10], v[14], m[s[ 4]], m[s[ 5]]);
+        G(v[3], v[7], v[11], v[15], m[s[ 6]], m[s[ 7]]);
+        G(v[0], v[5], v[10], v[15], m[s[ 8]], m[s[ 9]]);
+        G(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+        G(v[2], v[7], v[ 8], v[13], m[s[12]], m[s[13]]);
+        G(v[3], v[4], v[ 9], v[14], m[s[14]], m[s[15]]);
+    }
+
+    for (uint32_t index = 0; index < 8; index++)
+    {
+        ctx->h[index] ^= v[index] ^ v[index + 8];
+    }
+}
+
+static void blake2s_increment(blake2s_context* ctx, uint32_t length)
+{
+    ctx->t[0] += length;
+
+    if (ctx->t[0] < length)
+    {
+        ctx->t[1]++;
+    }
+}
+
+/**
+ * Start a BLAKE2s computation without key and with a 256 bit digest.
+ */
+void blake2s_starts(blake2s_context* ctx)
+{
+    memcpy(ctx->h, blake2s_iv, sizeof(ctx->h));
+
+    /* parameter block: digest length 32, no key, fanout 1, depth 1 */
+    ctx->h[0] ^= 0x01010000 | BLAKE2S_OUTPUT_SIZE;
+
+    ctx->t[0] = 0;
+    ctx->t[1] = 0;
+    ctx->length = 0;
+}
+
+/**
+ * Add data to a BLAKE2s computation.
+ * @detail The last block is only compressed in blake2s_finish, so a full
+ *         buffer is kept until more data arrives.
+ */
+void blake2s_update(blake2s_context* ctx, const uint8_t* data, uint32_t length)
+{
+    while (length > 0)
+    {
+        /* compress buffered block only once it is known not to be last */
+        if (ctx->length == BLAKE2S_BLOCK_SIZE)
+        {
+            blake2s_increment(ctx, BLAKE2S_BLOCK_SIZE);
+            blake2s_compress(ctx, ctx->buffer, 0);
+            ctx->length = 0;
+        }
+
+        /* compress directly from input while more data follows */
+        if ((ctx->length == 0) && (length > BLAKE2S_BLOCK_SIZE))
+        {
+            blake2s_increment(ctx, BLAKE2S_BLOCK_SIZE);
+            blake2s_compress(ctx, data, 0);
+            data += BLAKE2S_BLOCK_SIZE;
+            length -= BLAKE2S_BLOCK_SIZE;
+        }
+        else
+        {
+            uint32_t copy = BLAKE2S_BLOCK_SIZE - ctx->length;
+
+            if (copy > length)
+            {
+                copy = length;
+            }
+
+            memcpy(&ctx->buffer[ctx->length], data, copy);
+            ctx->length += copy;
+            data += copy;
+            length -= copy;
+        }
+    }
+}
+
+/**
+ * Finish a BLAKE2s computation and write the digest.
+ */
+void blake2s_finish(blake2s_context* ctx, uint8_t output[BLAKE2S_OUTPUT_SIZE])
+{
+    blake2s_increment(ctx, ctx->length);
+
+    /* pad last block with zeros */
+    memset(&ctx->buffer[ctx->length], 0, BLAKE2S_BLOCK_SIZE - ctx->length);
+    blake2s_compress(ctx, ctx->buffer, 1);
+
+    for (uint32_t index = 0; index < BLAKE2S_OUTPUT_SIZE; index++)
+    {
+        output[index] = (uint8_t) (ctx->h[index / 4] >> (8 * (index % 4)));
+    }
+}
+
+#endif // BLAKE2S_ENABLED
@@ -0,0 +1,60 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef BLAKE2S_H
+#define BLAKE2S_H
+
+#include <stdint.h>
+
+/* BLAKE2s is only compiled in when enabled, it is not needed to boot */
+#ifndef BLAKE2S_ENABLED
+#if defined(MBED_CONF_APP_BLAKE2S_ENABLED)
+#define BLAKE2S_ENABLED MBED_CONF_APP_BLAKE2S_ENABLED
+#else
+#define BLAKE2S_ENABLED 0
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLAKE2S_BLOCK_SIZE  64
+#define BLAKE2S_OUTPUT_SIZE 32
+
+/**
+ * Unkeyed BLAKE2s (RFC 7693) with a 256 bit digest.
+ */
+typedef struct {
+    uint32_t h[8];
+    uint32_t t[2];
+    uint8_t  buffer[BLAKE2S_BLOCK_SIZE];
+    uint32_t length;
+} blake2s_context;
+
+void blake2s_starts(blake2s_context* ctx);
+
+void blake2s_update(blake2s_context* ctx, const uint8_t* data, uint32_t length);
+
+void blake2s_finish(blake2s_context* ctx, uint8_t output[BLAKE2S_OUTPUT_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLAKE2S_H
@@ -21,6 +21,7 @@
 
 #include <stdint.h>
 #include "bootloader_config.h"
+#include "energy.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -34,6 +35,15 @@ extern "C" {
 
 #define CLEAR_EVENT 0xFFFFFFFF
 
+/* Bytes per step of crc16Update, each slice takes 512 bytes of flash */
+#ifndef CRC16_SLICES
+#define CRC16_SLICES 4
+#endif
+
+#if (CRC16_SLICES < 2) || (CRC16_SLICES > 8)
+#error "CRC16_SLICES must be between 2 and 8"
+#endif
+
 enum {
     RESULT_SUCCESS,
     RESULT_ERROR,
@@ -49,8 +59,14 @@ void arm_ucp_event_handler(uint32_t event);
 
 void printSHA256(const uint8_t SHA[SIZEOF_SHA256]);
 
+void printDigest(const char* name, const uint8_t digest[SIZEOF_SHA256]);
+
 void printProgress(uint32_t progress, uint32_t total);
 
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, uint32_t length);
+
+uint16_t crc16Update(uint16_t crc, const uint8_t* data, uint32_t length);
+
 #define MBED_BOOTLOADER_ASSERT(condition, ...) { \
     if (!(condition)) {                          \
         tr_error(__VA_ARGS__);                   \
@@ -66,6 +82,13 @@ void printProgress(uint32_t progress, uint32_t total);
 #include <inttypes.h>
 #include <stdio.h>
 
+/* count printed bytes for the energy report */
+#if ENERGY_ACCOUNTING == 1
+#define BOOTLOADER_PRINTF(...) energyCountPrint(printf(__VA_ARGS__))
+#else
+#define BOOTLOADER_PRINTF(...) printf(__VA_ARGS__)
+#endif
+
 #ifdef tr_debug
 #undef tr_debug
 #endif
@@ -78,22 +101,22 @@ void printProgress(uint32_t progress, uint32_t total);
 #ifdef tr_info
 #undef tr_info
 #endif
-#define tr_info(fmt, ...)    printf("[BOOT] " fmt "\r\n", ##__VA_ARGS__)
+#define tr_info(fmt, ...)    BOOTLOADER_PRINTF("[BOOT] " fmt "\r\n", ##__VA_ARGS__)
 
 #ifdef tr_warning
 #undef tr_warning
 #endif
-#define tr_warning(fmt, ...) printf("[WARN] " fmt "\r\n", ##__VA_ARGS__)
+#define tr_warning(fmt, ...) BOOTLOADER_PRINTF("[WARN] " fmt "\r\n", ##__VA_ARGS__)
 
 #ifdef tr_error
 #undef tr_error
 #endif
-#define tr_error(fmt, ...)   printf("[ERR ] " fmt "\r\n", ##__VA_ARGS__)
+#define tr_error(fmt, ...)   BOOTLOADER_PRINTF("[ERR ] " fmt "\r\n", ##__VA_ARGS__)
 
 #ifdef tr_trace
 #undef tr_trace
 #endif
-#define tr_trace(fmt, ...)   printf(fmt, ##__VA_ARGS__)
+#define tr_trace(fmt, ...)   BOOTLOADER_PRINTF(fmt, ##__VA_ARGS__)
 
 #ifdef tr_flush
 #undef tr_flush
@@ -0,0 +1,340 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include "coprocessor.h"
+
+#include "update-client-paal/arm_uc_paal_update.h"
+#include "mbedtls/sha256.h"
+
+#include <inttypes.h>
+
+#define COPROCESSOR_ACK 0x06
+
+SerialCoprocessorTransport::SerialCoprocessorTransport(PinName tx,
+                                                       PinName rx,
+                                                       int baud,
+                                                       uint32_t timeoutMs)
+    : _serial(tx, rx, baud),
+      _timeoutMs(timeoutMs),
+      _rxHead(0),
+      _rxOverflow(false),
+      _rxTail(0)
+{
+    /* polling would lose bytes arriving while a chunk is transmitted */
+    _serial.attach(Callback<void()>(this, &SerialCoprocessorTransport::onReceive),
+                   SerialBase::RxIrq);
+}
+
+bool SerialCoprocessorTransport::getVersion(uint64_t* version)
+{
+    const uint8_t command = 'V';
+    uint8_t response[9] = { 0 };
+
+    flush();
+
+    bool result = write(&command, sizeof(command)) &&
+                  read(response, sizeof(response)) &&
+                  (response[0] == COPROCESSOR_ACK);
+
+    if (result && version)
+    {
+        *version = 0;
+
+        for (uint32_t index = 8; index > 0; index--)
+        {
+            *version = (*version << 8) | response[index];
+        }
+    }
+
+    return result;
+}
+
+bool SerialCoprocessorTransport::begin(const arm_uc_firmware_details_t* details)
+{
+    const uint8_t command = 'B';
+    uint8_t response = 0;
+
+    flush();
+
+    return write(&command, sizeof(command)) &&
+           writeLE(details->size, 4) &&
+           write(details->hash, SIZEOF_SHA256) &&
+           read(&response, sizeof(response)) &&
+           (response == COPROCESSOR_ACK);
+}
+
+bool SerialCoprocessorTransport::send(uint32_t offset,
+                                      const uint8_t* data,
+                                      uint32_t length)
+{
+    const uint8_t command = 'D';
+
+    /* answers to earlier chunks stay queued, no flush here */
+    return (length <= 0xFFFF) &&
+           write(&command, sizeof(command)) &&
+           writeLE(offset, 4) &&
+           writeLE(length, 2) &&
+           write(data, length) &&
+           writeLE(crc32Update(0, data, length), 4);
+}
+
+bool SerialCoprocessorTransport::waitAck(void)
+{
+    uint8_t response = 0;
+
+    return read(&response, sizeof(response)) && (response == COPROCESSOR_ACK);
+}
+
+bool SerialCoprocessorTransport::end(bool commit)
+{
+    const uint8_t command[] = { 'E', commit };
+    uint8_t response = 0;
+
+    /* answers to the data chunks have all been read, keep any late NAK */
+    return write(command, sizeof(command)) &&
+           read(&response, sizeof(response)) &&
+           (response == COPROCESSOR_ACK);
+}
+
+/**
+ * RX interrupt handler, queue every received byte.
+ */
+void SerialCoprocessorTransport::onReceive(void)
+{
+    while (_serial.readable())
+    {
+        uint8_t byte = _serial.getc();
+        uint32_t next = (_rxHead + 1) % COPROCESSOR_RX_BUFFER_SIZE;
+
+        if (next == _rxTail)
+        {
+            _rxOverflow = true;
+        }
+        else
+        {
+            _rxBuffer[_rxHead] = byte;
+            _rxHead = next;
+        }
+    }
+}
+
+/**
+ * Drop stale bytes, e.g., an answer that arrived after its timeout.
+ */
+void SerialCoprocessorTransport::flush(void)
+{
+    _rxTail = _rxHead;
+    _rxOverflow = false;
+}
+
+bool SerialCoprocessorTransport::write(const uint8_t* data, uint32_t length)
+{
+    Timer timer;
+    timer.start();
+
+    uint32_t index = 0;
+
+    while ((index < length) && (timer.read_ms() < (int) _timeoutMs))
+    {
+        if (_serial.writeable())
+        {
+            _serial.putc(data[index++]);
+        }
+    }
+
+    ENERGY_COUNT(uart, index);
+
+    if (index < length)
+    {
+        tr_error("Coprocessor write timeout");
+    }
+
+    return (index == length);
+}
+
+bool SerialCoprocessorTransport::writeLE(uint64_t value, uint32_t length)
+{
+    bool result = true;
+
+    for (uint32_t index = 0; (index < length) && result; index++)
+    {
+        uint8_t byte = value >> (8 * index);
+
+        result = write(&byte, sizeof(byte));
+    }
+
+    return result;
+}
+
+bool SerialCoprocessorTransport::read(uint8_t* data, uint32_t length)
+{
+    Timer timer;
+    timer.start();
+
+    uint32_t index = 0;
+
+    while ((index < length) && (timer.read_ms() < (int) _timeoutMs))
+    {
+        if (_rxTail != _rxHead)
+        {
+            data[index++] = _rxBuffer[_rxTail];
+            _rxTail = (_rxTail + 1) % COPROCESSOR_RX_BUFFER_SIZE;
+        }
+    }
+
+    /* a lost byte would shift every later answer */
+    if (_rxOverflow)
+    {
+        tr_error("Coprocessor RX overflow");
+
+        return false;
+    }
+
+    return (index == length);
+}
+
+/**
+ * Stream a stored firmware to the coprocessor
+ * @detail Up to COPROCESSOR_CHUNKS_IN_FLIGHT chunks are outstanding, so
+ *         storage reads overlap with the coprocessor writing earlier
+ *         chunks. The forwarded bytes are hashed and the transfer is only
+ *         committed if they match the hash in the slot header.
+ * @param  index
+ *             Index of the stored firmware.
+ * @param  details
+ *             Header of the stored firmware.
+ * @param  transport
+ *             Link to the coprocessor loader.
+ * @return true if the coprocessor committed the new firmware.
+ */
+bool forwardCoprocessorFirmware(uint32_t index,
+                                arm_uc_firmware_details_t* details,
+                                CoprocessorTransport* transport)
+{
+    tr_debug("forwardCoprocessorFirmware");
+
+    bool result = false;
+
+    if (details && transport)
+    {
+        result = transport->begin(details);
+
+        /* hash the bytes actually forwarded */
+        mbedtls_sha256_context mbedtls_ctx;
+        mbedtls_sha256_init(&mbedtls_ctx);
+        mbedtls_sha256_starts(&mbedtls_ctx, 0);
+
+        uint32_t offset = 0;
+        uint32_t inFlight = 0;
+        uint32_t slot = 0;
+
+        while (result && (offset < details->size))
+        {
+            /* reuse a chunk buffer only once its chunk is acknowledged */
+            if (inFlight == COPROCESSOR_CHUNKS_IN_FLIGHT)
+            {
+                result = transport->waitAck();
+                inFlight--;
+            }
+
+            if (result)
+            {
+                arm_uc_buffer_t buffer = {
+                    .size_max = COPROCESSOR_CHUNK_SIZE,
+                    .size     = 0,
+                    .ptr      = &buffer_array[slot * COPROCESSOR_CHUNK_SIZE]
+                };
+
+                /* clear most recent UCP event */
+                event_callback = CLEAR_EVENT;
+
+                /* set the number of bytes expected */
+                buffer.size = (details->size - offset) > buffer.size_max ?
+                                buffer.size_max : (details->size - offset);
+
+                /* fill buffer using UCP */
+                arm_uc_error_t ucp_status = ARM_UCP_Read(index, offset, &buffer);
+
+                /* wait for event if the call is accepted */
+                if (ucp_status.error == ERR_NONE)
+                {
+                    while (event_callback == CLEAR_EVENT)
+                    {
+                        __WFI();
+                    }
+                }
+
+                /* check status and actual read size */
+                if ((event_callback == ARM_UC_PAAL_EVENT_READ_DONE) &&
+                    (buffer.size > 0))
+                {
+                    mbedtls_sha256_update(&mbedtls_ctx, buffer.ptr, buffer.size);
+                    ENERGY_COUNT(storageRead, buffer.size);
+                    ENERGY_COUNT(storageReadCalls, 1);
+                    ENERGY_COUNT(sha256, buffer.size);
+
+                    result = transport->send(offset, buffer.ptr, buffer.size);
+
+                    offset += buffer.size;
+                    inFlight++;
+                    slot = (slot + 1) % COPROCESSOR_CHUNKS_IN_FLIGHT;
+                }
+                else
+                {
+                    tr_error("ARM_UCP_Read returned 0 bytes");
+
+                    result = false;
+                }
+            }
+
+#if defined(SHOW_PROGRESS_BAR) && SHOW_PROGRESS_BAR == 1
+            printProgress(offset, details->size);
+#endif
+        }
+
+        /* wait for the remaining chunks */
+        while (result && (inFlight > 0))
+        {
+            result = transport->waitAck();
+            inFlight--;
+        }
+
+        uint8_t SHA[SIZEOF_SHA256] = { 0 };
+        mbedtls_sha256_finish(&mbedtls_ctx, SHA);
+        mbedtls_sha256_free(&mbedtls_ctx);
+
+        bool hashValid = (memcmp(details->hash, SHA, SIZEOF_SHA256) == 0);
+
+        if (result && !hashValid)
+        {
+            printSHA256(details->hash);
+            printSHA256(SHA);
+        }
+
+        /* abort the transfer on the coprocessor on any failure */
+        bool committed = transport->end(result && hashValid);
+
+        result = result && hashValid && committed;
+    }
+
+    return result;
+}
@@ -0,0 +1,171 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef COPROCESSOR_H
+#define COPROCESSOR_H
+
+#include "update-client-paal/arm_uc_paal_update_api.h"
+#include "bootloader_common.h"
+#include "mbed.h"
+
+#include <stdint.h>
+
+/* Bytes per chunk sent to the coprocessor */
+#ifndef COPROCESSOR_CHUNK_SIZE
+#define COPROCESSOR_CHUNK_SIZE 1024
+#endif
+
+/* the chunk length is sent as a 2 byte field */
+#if (COPROCESSOR_CHUNK_SIZE == 0) || (COPROCESSOR_CHUNK_SIZE > 0xFFFF)
+#error "COPROCESSOR_CHUNK_SIZE must be between 1 and 65535"
+#endif
+
+/* Chunks sent ahead of the oldest unacknowledged one */
+#ifndef COPROCESSOR_CHUNKS_IN_FLIGHT
+#define COPROCESSOR_CHUNKS_IN_FLIGHT 4
+#endif
+
+/* every chunk in flight keeps its own part of the main buffer */
+#if (COPROCESSOR_CHUNK_SIZE * COPROCESSOR_CHUNKS_IN_FLIGHT) > BUFFER_SIZE
+#error "COPROCESSOR_CHUNK_SIZE * COPROCESSOR_CHUNKS_IN_FLIGHT larger than BUFFER_SIZE"
+#endif
+
+#ifndef COPROCESSOR_MAX_RETRIES
+#define COPROCESSOR_MAX_RETRIES 1
+#endif
+
+/* Set to 1 to send a valid image to a coprocessor that cannot report its
+   version. Otherwise it is left alone, so it is not reflashed every boot. */
+#ifndef COPROCESSOR_FORCE_UPDATE
+#define COPROCESSOR_FORCE_UPDATE 0
+#endif
+
+/* Bytes received from the coprocessor while the bootloader is busy, e.g.,
+   acknowledgements arriving while the next chunk is transmitted */
+#ifndef COPROCESSOR_RX_BUFFER_SIZE
+#define COPROCESSOR_RX_BUFFER_SIZE 32
+#endif
+
+/* one slot of the ring buffer is always left empty */
+#if COPROCESSOR_RX_BUFFER_SIZE <= COPROCESSOR_CHUNKS_IN_FLIGHT
+#error "COPROCESSOR_RX_BUFFER_SIZE must exceed COPROCESSOR_CHUNKS_IN_FLIGHT"
+#endif
+
+/**
+ * Link to the loader of an external coprocessor.
+ * @detail Chunks are acknowledged in the order they were sent. Data passed
+ *         to send() must stay valid until its chunk is acknowledged, which
+ *         allows implementations to transmit asynchronously.
+ */
+class CoprocessorTransport
+{
+public:
+    virtual ~CoprocessorTransport() {}
+
+    /**
+     * Version of the firmware installed on the coprocessor.
+     * @return false if the coprocessor cannot report a version.
+     */
+    virtual bool getVersion(uint64_t* version) = 0;
+
+    /**
+     * Announce a new firmware and prepare the coprocessor to receive it.
+     */
+    virtual bool begin(const arm_uc_firmware_details_t* details) = 0;
+
+    /**
+     * Send one chunk without waiting for its acknowledgement.
+     */
+    virtual bool send(uint32_t offset, const uint8_t* data, uint32_t length) = 0;
+
+    /**
+     * Wait for the oldest unacknowledged chunk to be written.
+     */
+    virtual bool waitAck(void) = 0;
+
+    /**
+     * Finish the transfer.
+     * @param commit true to activate the new firmware, false to abort.
+     * @return true if the coprocessor accepted the request.
+     */
+    virtual bool end(bool commit) = 0;
+};
+
+/**
+ * Reference transport for a coprocessor loader on a UART.
+ * @detail Requests are a command byte followed by little endian fields,
+ *         each answered with ACK (0x06) or NAK (0x15):
+ *           'V'                                  -> ACK, version (8)
+ *           'B' size (4) hash (32)               -> ACK
+ *           'D' offset (4) length (2) data crc32 -> ACK once written
+ *           'E' commit (1)                       -> ACK
+ *         'D' requests may be sent before earlier ones are answered.
+ *         Received bytes are queued from the RX interrupt, so answers
+ *         arriving while a chunk is being transmitted are not lost.
+ *         tools/coprocessor_loader.py implements the loader side on a host.
+ */
+class SerialCoprocessorTransport : public CoprocessorTransport
+{
+public:
+    SerialCoprocessorTransport(PinName tx, PinName rx, int baud = 115200,
+                               uint32_t timeoutMs = 1000);
+
+    virtual bool getVersion(uint64_t* version);
+    virtual bool begin(const arm_uc_firmware_details_t* details);
+    virtual bool send(uint32_t offset, const uint8_t* data, uint32_t length);
+    virtual bool waitAck(void);
+    virtual bool end(bool commit);
+
+private:
+    void onReceive(void);
+    void flush(void);
+    bool write(const uint8_t* data, uint32_t length);
+    bool writeLE(uint64_t value, uint32_t length);
+    bool read(uint8_t* data, uint32_t length);
+
+    RawSerial _serial;
+    const uint32_t _timeoutMs;
+
+    /* written by the RX interrupt only */
+    uint8_t _rxBuffer[COPROCESSOR_RX_BUFFER_SIZE];
+    volatile uint32_t _rxHead;
+    volatile bool _rxOverflow;
+
+    /* written by read() only */
+    volatile uint32_t _rxTail;
+};
+
+/**
+ * Stream a stored firmware to the coprocessor
+ * @detail Up to COPROCESSOR_CHUNKS_IN_FLIGHT chunks are outstanding, so
+ *         storage reads overlap with the coprocessor writing earlier
+ *         chunks. The forwarded bytes are hashed and the transfer is only
+ *         committed if they match the hash in the slot header.
+ * @param  index
+ *             Index of the stored firmware.
+ * @param  details
+ *             Header of the stored firmware.
+ * @param  transport
+ *             Link to the coprocessor loader.
+ * @return true if the coprocessor committed the new firmware.
+ */
+bool forwardCoprocessorFirmware(uint32_t index,
+                                arm_uc_firmware_details_t* details,
+                                CoprocessorTransport* transport);
+
+#endif // COPROCESSOR_H
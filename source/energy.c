@@ -0,0 +1,107 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include "energy.h"
+#include "bootloader_common.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#if ENERGY_ACCOUNTING == 1
+
+energy_counters_t energyCounters = { 0 };
+
+void energyCountPrint(int printed)
+{
+    if (printed > 0)
+    {
+        energyCounters.uart += printed;
+    }
+}
+
+/**
+ * Estimated energy in nJ for the given operation counts.
+ * @detail Must match energy_estimate() in tools/inspect_dumps.py.
+ */
+uint64_t energyEstimate(const energy_counters_t* counters)
+{
+    uint64_t bulk = (uint64_t) counters->storageRead * ENERGY_COST_STORAGE_READ +
+                    (uint64_t) counters->flashProgram * ENERGY_COST_FLASH_PROGRAM +
+                    (uint64_t) counters->sha256 * ENERGY_COST_SHA256 +
+                    (uint64_t) counters->blake2s * ENERGY_COST_BLAKE2S;
+
+    return (bulk / 1024) +
+           (uint64_t) counters->storageReadCalls * ENERGY_COST_STORAGE_READ_CALL +
+           (uint64_t) counters->flashProgramCalls * ENERGY_COST_FLASH_PROGRAM_CALL +
+           (uint64_t) counters->flashErase * ENERGY_COST_FLASH_ERASE +
+           (uint64_t) counters->uart * ENERGY_COST_UART;
+}
+
+void printEnergyReport(const char* label, const energy_counters_t* start)
+{
+    energy_counters_t delta = energyCounters;
+
+    if (start)
+    {
+        delta.storageRead -= start->storageRead;
+        delta.storageReadCalls -= start->storageReadCalls;
+        delta.flashProgram -= start->flashProgram;
+        delta.flashProgramCalls -= start->flashProgramCalls;
+        delta.flashErase -= start->flashErase;
+        delta.sha256 -= start->sha256;
+        delta.blake2s -= start->blake2s;
+        delta.uart -= start->uart;
+    }
+
+    /* the report itself is not part of the estimate */
+    uint64_t energy = energyEstimate(&delta);
+
+    tr_info("%s energy: %" PRIu32 " uJ", label, (uint32_t) (energy / 1000));
+    tr_info("Read %" PRIu32 " B in %" PRIu32 " calls, programmed %" PRIu32
+            " B in %" PRIu32 " calls, erased %" PRIu32 " sectors",
+            delta.storageRead, delta.storageReadCalls,
+            delta.flashProgram, delta.flashProgramCalls, delta.flashErase);
+    tr_info("SHA-256 %" PRIu32 " B, BLAKE2s %" PRIu32 " B, UART %" PRIu32 " B",
+            delta.sha256, delta.blake2s, delta.uart);
+}
+
+#else
+
+void energyCountPrint(int printed)
+{
+    (void) printed;
+}
+
+uint64_t energyEstimate(const energy_counters_t* counters)
+{
+    (void) counters;
+
+    return 0;
+}
+
+void printEnergyReport(const char* label, const energy_counters_t* start)
+{
+    (void) label;
+    (void) start;
+}
+
+#endif // ENERGY_ACCOUNTING
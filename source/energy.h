@@ -0,0 +1,145 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Set to 1 to count operations and report the estimated energy */
+#ifndef ENERGY_ACCOUNTING
+#define ENERGY_ACCOUNTING 0
+#endif
+
+/* Cost table in nJ, per KiB for bulk operations and per call for the fixed
+   cost of a storage read or flash program command. Unset costs count as 0. */
+#ifndef ENERGY_COST_STORAGE_READ
+#ifdef MBED_CONF_APP_ENERGY_STORAGE_READ
+#define ENERGY_COST_STORAGE_READ MBED_CONF_APP_ENERGY_STORAGE_READ
+#else
+#define ENERGY_COST_STORAGE_READ 0
+#endif
+#endif
+
+#ifndef ENERGY_COST_STORAGE_READ_CALL
+#ifdef MBED_CONF_APP_ENERGY_STORAGE_READ_CALL
+#define ENERGY_COST_STORAGE_READ_CALL MBED_CONF_APP_ENERGY_STORAGE_READ_CALL
+#else
+#define ENERGY_COST_STORAGE_READ_CALL 0
+#endif
+#endif
+
+#ifndef ENERGY_COST_FLASH_PROGRAM
+#ifdef MBED_CONF_APP_ENERGY_FLASH_PROGRAM
+#define ENERGY_COST_FLASH_PROGRAM MBED_CONF_APP_ENERGY_FLASH_PROGRAM
+#else
+#define ENERGY_COST_FLASH_PROGRAM 0
+#endif
+#endif
+
+#ifndef ENERGY_COST_FLASH_PROGRAM_CALL
+#ifdef MBED_CONF_APP_ENERGY_FLASH_PROGRAM_CALL
+#define ENERGY_COST_FLASH_PROGRAM_CALL MBED_CONF_APP_ENERGY_FLASH_PROGRAM_CALL
+#else
+#define ENERGY_COST_FLASH_PROGRAM_CALL 0
+#endif
+#endif
+
+#ifndef ENERGY_COST_FLASH_ERASE
+#ifdef MBED_CONF_APP_ENERGY_FLASH_ERASE
+#define ENERGY_COST_FLASH_ERASE MBED_CONF_APP_ENERGY_FLASH_ERASE
+#else
+#define ENERGY_COST_FLASH_ERASE 0
+#endif
+#endif
+
+#ifndef ENERGY_COST_SHA256
+#ifdef MBED_CONF_APP_ENERGY_SHA256
+#define ENERGY_COST_SHA256 MBED_CONF_APP_ENERGY_SHA256
+#else
+#define ENERGY_COST_SHA256 0
+#endif
+#endif
+
+#ifndef ENERGY_COST_BLAKE2S
+#ifdef MBED_CONF_APP_ENERGY_BLAKE2S
+#define ENERGY_COST_BLAKE2S MBED_CONF_APP_ENERGY_BLAKE2S
+#else
+#define ENERGY_COST_BLAKE2S 0
+#endif
+#endif
+
+#ifndef ENERGY_COST_UART
+#ifdef MBED_CONF_APP_ENERGY_UART
+#define ENERGY_COST_UART MBED_CONF_APP_ENERGY_UART
+#else
+#define ENERGY_COST_UART 0
+#endif
+#endif
+
+/**
+ * Operation counts the energy estimate is based on.
+ */
+typedef struct {
+    uint32_t storageRead;       /* bytes read from candidate storage */
+    uint32_t storageReadCalls;  /* ARM_UCP_Read calls */
+    uint32_t flashProgram;      /* bytes programmed into internal flash */
+    uint32_t flashProgramCalls; /* FlashIAP::program calls */
+    uint32_t flashErase;        /* internal flash sectors erased */
+    uint32_t sha256;            /* bytes hashed with SHA-256 */
+    uint32_t blake2s;           /* bytes hashed with BLAKE2s */
+    uint32_t uart;              /* bytes written to a UART */
+} energy_counters_t;
+
+#if ENERGY_ACCOUNTING == 1
+extern energy_counters_t energyCounters;
+
+#define ENERGY_COUNT(counter, amount) (energyCounters.counter += (amount))
+#else
+#define ENERGY_COUNT(counter, amount)
+#endif
+
+/**
+ * Count the return value of printf as UART bytes.
+ */
+void energyCountPrint(int printed);
+
+/**
+ * Estimated energy in nJ for the given operation counts.
+ */
+uint64_t energyEstimate(const energy_counters_t* counters);
+
+/**
+ * Print the operation counts since start and their estimated energy.
+ * @param  label
+ *             Name of the measured operation.
+ * @param  start
+ *             Snapshot of energyCounters taken at the start of the
+ *             operation, NULL to report everything since reset.
+ */
+void printEnergyReport(const char* label, const energy_counters_t* start);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ENERGY_H
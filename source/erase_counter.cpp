@@ -0,0 +1,600 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#include "erase_counter.h"
+#include "bootloader_config.h"
+#include "energy.h"
+
+#include "update-client-common/arm_uc_utilities.h"
+
+#include <string.h>
+
+#if ERASE_COUNTER_ENABLED
+
+#define ERASE_COUNTER_HEADER_WORDS (sizeof(erase_counter_header_t) / sizeof(uint32_t))
+
+/* bytes of a log entry before padding: sector index and its complement */
+#define ERASE_COUNTER_ENTRY_SIZE (2 * sizeof(uint32_t))
+
+static FlashIAP* counterFlash = NULL;
+
+/* bank header followed by the counter table, word aligned */
+static uint32_t counter_array[ERASE_COUNTER_HEADER_WORDS + ERASE_COUNTER_MAX_SECTORS];
+static erase_counter_header_t* const header = (erase_counter_header_t*) counter_array;
+static uint32_t* const counters = counter_array + ERASE_COUNTER_HEADER_WORDS;
+
+/* staging buffer for partial pages */
+static uint8_t page_array[ERASE_COUNTER_MAX_PAGE_SIZE];
+
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+} erase_counter_region_t;
+
+/* tracked regions, the active firmware first */
+static erase_counter_region_t regions[2];
+static uint32_t regionCount = 0;
+static bool storageTracked = false;
+
+static uint32_t sectorCount = 0;
+static uint32_t pageSize = 0;
+static uint32_t bankSize = 0;
+static uint32_t activeBank = 0;
+static uint32_t logOffset = 0;
+static bool logWritable = false;
+
+static uint32_t roundUpToPage(uint32_t size)
+{
+    return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+static uint32_t getBankAddress(uint32_t bank)
+{
+    return MBED_CONF_APP_ERASE_COUNTER_ADDRESS + bank * bankSize;
+}
+
+static uint32_t getTableOffset(void)
+{
+    return roundUpToPage(sizeof(erase_counter_header_t));
+}
+
+static uint32_t getLogStart(void)
+{
+    return getTableOffset() + roundUpToPage(sectorCount * sizeof(uint32_t));
+}
+
+static uint32_t getEntrySize(void)
+{
+    return roundUpToPage(ERASE_COUNTER_ENTRY_SIZE);
+}
+
+/**
+ * Number of sectors from start to end, or 0 if end is not on a sector
+ * boundary.
+ */
+static uint32_t countSectors(uint32_t start, uint32_t end)
+{
+    uint32_t count = 0;
+    uint32_t address = start;
+
+    while (address < end)
+    {
+        address += counterFlash->get_sector_size(address);
+        count++;
+    }
+
+    return (address == end) ? count : 0;
+}
+
+/**
+ * Index of the counter for the sector containing address.
+ */
+static bool getCounterIndex(uint32_t address, uint32_t* index)
+{
+    uint32_t base = 0;
+
+    for (uint32_t region = 0; region < regionCount; region++)
+    {
+        uint32_t sector = regions[region].start;
+        uint32_t offset = 0;
+
+        while (sector < regions[region].end)
+        {
+            uint32_t next = sector + counterFlash->get_sector_size(sector);
+
+            if ((address >= sector) && (address < next))
+            {
+                *index = base + offset;
+                return true;
+            }
+
+            sector = next;
+            offset++;
+        }
+
+        base += offset;
+    }
+
+    return false;
+}
+
+/**
+ * CRC of the bank header and table in RAM, computed with crc set to zero.
+ */
+static uint32_t getCounterCRC(void)
+{
+    uint32_t stored = header->crc;
+
+    header->crc = 0;
+    uint32_t crc = arm_uc_crc32((const uint8_t*) counter_array,
+                                sizeof(erase_counter_header_t) +
+                                sectorCount * sizeof(uint32_t));
+    header->crc = stored;
+
+    return crc;
+}
+
+/**
+ * Program data of any length, padding the last page with 0xFF.
+ */
+static int programPadded(const void* data, uint32_t address, uint32_t length)
+{
+    uint32_t full = length / pageSize * pageSize;
+    int status = 0;
+
+    if (full > 0)
+    {
+        status = counterFlash->program(data, address, full);
+        ENERGY_COUNT(flashProgram, full);
+        ENERGY_COUNT(flashProgramCalls, 1);
+    }
+
+    if ((status == 0) && (full < length))
+    {
+        memset(page_array, 0xFF, pageSize);
+        memcpy(page_array, ((const uint8_t*) data) + full, length - full);
+
+        status = counterFlash->program(page_array, address + full, pageSize);
+        ENERGY_COUNT(flashProgram, pageSize);
+        ENERGY_COUNT(flashProgramCalls, 1);
+    }
+
+    return status;
+}
+
+/**
+ * Read the header and table of a bank into RAM and check them.
+ */
+static bool loadBank(uint32_t bank)
+{
+    const uint32_t address = getBankAddress(bank);
+
+    int status = counterFlash->read(header, address, sizeof(erase_counter_header_t));
+
+    if ((status != 0) ||
+        (header->magic != ERASE_COUNTER_MAGIC) ||
+        (header->sectorCount != sectorCount))
+    {
+        return false;
+    }
+
+    status = counterFlash->read(counters, address + getTableOffset(),
+                                sectorCount * sizeof(uint32_t));
+
+    return ((status == 0) && (getCounterCRC() == header->crc));
+}
+
+/**
+ * Write the counts in RAM to a bank with a new sequence number.
+ * @detail The header is programmed last, so the bank only becomes valid
+ *         once it is complete.
+ */
+static bool writeBank(uint32_t bank, uint32_t sequence)
+{
+    const uint32_t address = getBankAddress(bank);
+    int status = 0;
+
+    for (uint32_t sector = address;
+         (sector < address + bankSize) && (status == 0);
+         sector += counterFlash->get_sector_size(sector))
+    {
+        status = counterFlash->erase(sector, counterFlash->get_sector_size(sector));
+        ENERGY_COUNT(flashErase, 1);
+    }
+
+    if (status == 0)
+    {
+        status = programPadded(counters, address + getTableOffset(),
+                               sectorCount * sizeof(uint32_t));
+    }
+
+    if (status == 0)
+    {
+        header->magic = ERASE_COUNTER_MAGIC;
+        header->sequence = sequence;
+        header->sectorCount = sectorCount;
+        header->crc = getCounterCRC();
+
+        status = programPadded(header, address, sizeof(erase_counter_header_t));
+    }
+
+    return (status == 0);
+}
+
+/**
+ * Add the log of the active bank to the counts in RAM.
+ * @detail Entries that were cut short by a power loss fail the complement
+ *         check and are skipped, the log continues after them.
+ */
+static void replayLog(void)
+{
+    const uint32_t address = getBankAddress(activeBank);
+    const uint32_t entrySize = getEntrySize();
+
+    logOffset = getLogStart();
+
+    while (logOffset + entrySize <= bankSize)
+    {
+        uint32_t entry[2];
+
+        int status = counterFlash->read(entry, address + logOffset, sizeof(entry));
+
+        if ((status != 0) ||
+            ((entry[0] == 0xFFFFFFFF) && (entry[1] == 0xFFFFFFFF)))
+        {
+            break;
+        }
+
+        if ((entry[0] == ~entry[1]) && (entry[0] < sectorCount))
+        {
+            counters[entry[0]]++;
+        }
+
+        logOffset += entrySize;
+    }
+}
+
+/**
+ * True if the counter region overlaps start to end.
+ */
+static bool overlapsCounters(uint32_t start, uint32_t end)
+{
+    return (start < getBankAddress(2)) && (end > getBankAddress(0));
+}
+
+bool eraseCounterInit(FlashIAP* flash)
+{
+    counterFlash = flash;
+    sectorCount = 0;
+    regionCount = 0;
+    storageTracked = false;
+
+    pageSize = flash->get_page_size();
+    bankSize = MBED_CONF_APP_ERASE_COUNTER_SIZE / 2;
+
+    /* active firmware region */
+    regions[regionCount].start = FIRMWARE_METADATA_HEADER_ADDRESS;
+    regions[regionCount].end = MBED_CONF_APP_APPLICATION_START_ADDRESS +
+                               MBED_CONF_APP_MAX_APPLICATION_SIZE;
+    regionCount++;
+
+    /* candidate storage, if it is in internal flash */
+    const uint32_t flashStart = flash->get_flash_start();
+    const uint32_t flashEnd = flashStart + flash->get_flash_size();
+    const uint32_t storageStart = MBED_CONF_UPDATE_CLIENT_STORAGE_ADDRESS;
+    const uint32_t storageEnd = storageStart + MBED_CONF_UPDATE_CLIENT_STORAGE_SIZE;
+
+    if ((storageStart >= flashStart) && (storageEnd <= flashEnd))
+    {
+        regions[regionCount].start = storageStart;
+        regions[regionCount].end = storageEnd;
+        regionCount++;
+        storageTracked = true;
+    }
+
+    bool result = (pageSize <= ERASE_COUNTER_MAX_PAGE_SIZE);
+
+    for (uint32_t region = 0; (region < regionCount) && result; region++)
+    {
+        uint32_t count = countSectors(regions[region].start, regions[region].end);
+
+        /* the counter region must not be erased as part of a tracked one */
+        result = (count > 0) &&
+                 !overlapsCounters(regions[region].start, regions[region].end);
+
+        sectorCount += count;
+    }
+
+    /* nor overwrite the bootloader or anything it keeps in flash */
+    const erase_counter_region_t reserved[] = {
+        { flashStart, ERASE_COUNTER_BOOTLOADER_END },
+#if defined(PAL_INTERNAL_FLASH_SECTION_1_ADDRESS) && \
+    defined(PAL_INTERNAL_FLASH_SECTION_1_SIZE)
+        { PAL_INTERNAL_FLASH_SECTION_1_ADDRESS,
+          PAL_INTERNAL_FLASH_SECTION_1_ADDRESS + PAL_INTERNAL_FLASH_SECTION_1_SIZE },
+#endif
+#if defined(PAL_INTERNAL_FLASH_SECTION_2_ADDRESS) && \
+    defined(PAL_INTERNAL_FLASH_SECTION_2_SIZE)
+        { PAL_INTERNAL_FLASH_SECTION_2_ADDRESS,
+          PAL_INTERNAL_FLASH_SECTION_2_ADDRESS + PAL_INTERNAL_FLASH_SECTION_2_SIZE },
+#endif
+        { FIRMWARE_METADATA_HEADER_ADDRESS, MBED_CONF_APP_APPLICATION_START_ADDRESS }
+    };
+
+    for (uint32_t region = 0;
+         (region < sizeof(reserved) / sizeof(reserved[0])) && result;
+         region++)
+    {
+        result = !overlapsCounters(reserved[region].start, reserved[region].end);
+    }
+
+    /* both banks must be whole sectors with room for at least one entry */
+    result = result &&
+             (sectorCount <= ERASE_COUNTER_MAX_SECTORS) &&
+             (countSectors(getBankAddress(0), getBankAddress(1)) > 0) &&
+             (countSectors(getBankAddress(1), getBankAddress(2)) > 0) &&
+             (getLogStart() + getEntrySize() <= bankSize);
+
+    if (!result)
+    {
+        counterFlash = NULL;
+        return false;
+    }
+
+    bool valid0 = loadBank(0);
+    uint32_t sequence0 = header->sequence;
+    bool valid1 = loadBank(1);
+    uint32_t sequence1 = header->sequence;
+
+    /* newest valid bank, sequence numbers may wrap */
+    if (valid0 && (!valid1 || ((int32_t) (sequence0 - sequence1) > 0)))
+    {
+        activeBank = 0;
+        result = loadBank(0);
+    }
+    else if (valid1)
+    {
+        activeBank = 1;
+    }
+    else
+    {
+        /* no valid bank, format */
+        memset(counters, 0, sectorCount * sizeof(uint32_t));
+
+        activeBank = 0;
+        result = writeBank(activeBank, 1);
+    }
+
+    if (result)
+    {
+        replayLog();
+        logWritable = true;
+    }
+    else
+    {
+        counterFlash = NULL;
+    }
+
+    return result;
+}
+
+bool eraseCounterRecord(uint32_t address)
+{
+    uint32_t index = 0;
+
+    if (counterFlash == NULL)
+    {
+        return false;
+    }
+
+    if (!getCounterIndex(address, &index))
+    {
+        return true;
+    }
+
+    const uint32_t entrySize = getEntrySize();
+
+    /* move the counts to the other bank once the log is full */
+    if (logWritable && (logOffset + entrySize > bankSize))
+    {
+        logWritable = writeBank(1 - activeBank, header->sequence + 1);
+
+        if (logWritable)
+        {
+            activeBank = 1 - activeBank;
+            logOffset = getLogStart();
+        }
+    }
+
+    /* count in RAM even if the log cannot be written */
+    counters[index]++;
+
+    if (logWritable)
+    {
+        const uint32_t entry[2] = { index, ~index };
+
+        logWritable = (programPadded(entry, getBankAddress(activeBank) + logOffset,
+                                     sizeof(entry)) == 0);
+
+        logOffset += entrySize;
+    }
+
+    /* stop writing after a failure instead of wearing the counter region */
+    return logWritable;
+}
+
+bool eraseCounterGet(uint32_t address, uint32_t* count)
+{
+    uint32_t index = 0;
+
+    bool result = (counterFlash != NULL) && count &&
+                  getCounterIndex(address, &index);
+
+    if (result)
+    {
+        *count = counters[index];
+    }
+
+    return result;
+}
+
+bool eraseCounterGetSlotWear(uint32_t slot, uint32_t* count)
+{
+    if ((counterFlash == NULL) || !storageTracked || !count ||
+        (slot >= MAX_FIRMWARE_LOCATIONS))
+    {
+        return false;
+    }
+
+    const uint32_t slotSize = MBED_CONF_UPDATE_CLIENT_STORAGE_SIZE /
+                              MAX_FIRMWARE_LOCATIONS;
+    const uint32_t slotStart = MBED_CONF_UPDATE_CLIENT_STORAGE_ADDRESS +
+                               slot * slotSize;
+
+    /* storage counters follow the active region counters */
+    uint32_t index = countSectors(regions[0].start, regions[0].end);
+
+    *count = 0;
+
+    for (uint32_t sector = regions[1].start;
+         sector < regions[1].end;
+         sector += counterFlash->get_sector_size(sector))
+    {
+        if ((sector >= slotStart) && (sector < slotStart + slotSize) &&
+            (counters[index] > *count))
+        {
+            *count = counters[index];
+        }
+
+        index++;
+    }
+
+    return true;
+}
+
+bool eraseCounterGetLeastWornSlot(uint32_t* slot)
+{
+    uint32_t leastWear = 0xFFFFFFFF;
+    bool result = (slot != NULL);
+
+    for (uint32_t index = 0;
+         (index < MAX_FIRMWARE_LOCATIONS) && result;
+         index++)
+    {
+        uint32_t wear = 0;
+
+#if defined(COPROCESSOR_FIRMWARE_SLOT)
+        /* reserved for the coprocessor image */
+        if (index == COPROCESSOR_FIRMWARE_SLOT)
+        {
+            continue;
+        }
+#endif
+
+        result = eraseCounterGetSlotWear(index, &wear);
+
+        /* first slot wins on equal wear */
+        if (result && (wear < leastWear))
+        {
+            leastWear = wear;
+            *slot = index;
+        }
+    }
+
+    return result;
+}
+
+/* PAAL the wrapper forwards to */
+static const ARM_UC_PAAL_UPDATE* wrappedPAAL = NULL;
+static ARM_UC_PAAL_UPDATE wrapperPAAL;
+
+/**
+ * Count the erase of the slot a new candidate is prepared in.
+ * @detail Counted once the PAAL has accepted the call, a rejected call
+ *         erases nothing. Every sector of the slot is counted, as the PAAL
+ *         does not report how much of it is erased.
+ */
+static arm_uc_error_t wrapperPrepare(uint32_t location,
+                                     const arm_uc_firmware_details_t* details,
+                                     arm_uc_buffer_t* buffer)
+{
+    arm_uc_error_t result = wrappedPAAL->Prepare(location, details, buffer);
+
+    if ((result.error == ERR_NONE) &&
+        (counterFlash != NULL) && storageTracked &&
+        (location < MAX_FIRMWARE_LOCATIONS))
+    {
+        const uint32_t slotSize = MBED_CONF_UPDATE_CLIENT_STORAGE_SIZE /
+                                  MAX_FIRMWARE_LOCATIONS;
+        const uint32_t slotStart = MBED_CONF_UPDATE_CLIENT_STORAGE_ADDRESS +
+                                   location * slotSize;
+
+        for (uint32_t sector = slotStart;
+             sector < slotStart + slotSize;
+             sector += counterFlash->get_sector_size(sector))
+        {
+            eraseCounterRecord(sector);
+        }
+    }
+
+    return result;
+}
+
+const ARM_UC_PAAL_UPDATE* eraseCounterWrapPAAL(const ARM_UC_PAAL_UPDATE* paal)
+{
+    wrappedPAAL = paal;
+
+    wrapperPAAL = *paal;
+    wrapperPAAL.Prepare = wrapperPrepare;
+
+    return &wrapperPAAL;
+}
+
+#else
+
+bool eraseCounterInit(FlashIAP*)
+{
+    return false;
+}
+
+bool eraseCounterRecord(uint32_t)
+{
+    return true;
+}
+
+bool eraseCounterGet(uint32_t, uint32_t*)
+{
+    return false;
+}
+
+bool eraseCounterGetSlotWear(uint32_t, uint32_t*)
+{
+    return false;
+}
+
+bool eraseCounterGetLeastWornSlot(uint32_t*)
+{
+    return false;
+}
+
+const ARM_UC_PAAL_UPDATE* eraseCounterWrapPAAL(const ARM_UC_PAAL_UPDATE* paal)
+{
+    return paal;
+}
+
+#endif // ERASE_COUNTER_ENABLED
@@ -0,0 +1,135 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef ERASE_COUNTER_H
+#define ERASE_COUNTER_H
+
+#include "mbed.h"
+
+#include "update-client-paal/arm_uc_paal_update_api.h"
+
+#include <stdint.h>
+
+/* Erase counters are kept if the counter region is configured */
+#if defined(MBED_CONF_APP_ERASE_COUNTER_ADDRESS) && \
+    defined(MBED_CONF_APP_ERASE_COUNTER_SIZE)
+#define ERASE_COUNTER_ENABLED 1
+#else
+#define ERASE_COUNTER_ENABLED 0
+#endif
+
+/* Maximum number of tracked sectors, 4 bytes of RAM each */
+#ifndef ERASE_COUNTER_MAX_SECTORS
+#define ERASE_COUNTER_MAX_SECTORS 512
+#endif
+
+/* Largest supported flash program page */
+#ifndef ERASE_COUNTER_MAX_PAGE_SIZE
+#define ERASE_COUNTER_MAX_PAGE_SIZE 64
+#endif
+
+/* End of the bootloader, which starts at the beginning of flash */
+#ifndef ERASE_COUNTER_BOOTLOADER_END
+#if defined(BOOTLOADER_ADDR) && defined(BOOTLOADER_SIZE)
+/* application built with bootloader_img */
+#define ERASE_COUNTER_BOOTLOADER_END (BOOTLOADER_ADDR + BOOTLOADER_SIZE)
+#elif defined(POST_APPLICATION_ADDR)
+/* bootloader built with target.restrict_size */
+#define ERASE_COUNTER_BOOTLOADER_END POST_APPLICATION_ADDR
+#elif defined(PAL_INTERNAL_FLASH_SECTION_1_ADDRESS)
+/* the bootloader is placed below the SOTP sections */
+#define ERASE_COUNTER_BOOTLOADER_END PAL_INTERNAL_FLASH_SECTION_1_ADDRESS
+#else
+#define ERASE_COUNTER_BOOTLOADER_END FIRMWARE_METADATA_HEADER_ADDRESS
+#endif
+#endif
+
+#define ERASE_COUNTER_MAGIC 0x45524153
+
+/**
+ * Header of a counter bank.
+ * @detail The counter region is split into two banks of whole sectors. A
+ *         bank holds the header, a table with one uint32_t count per
+ *         tracked sector, and a log of erases since the table was written.
+ *         Each log entry is one program page starting with the sector
+ *         index and its complement. When the log is full, the counts are
+ *         written to the other bank with the next sequence number, header
+ *         last, so one valid bank survives a power cut at any time. The
+ *         crc covers the header, with crc set to zero, and the table.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t sectorCount;
+    uint32_t crc;
+} erase_counter_header_t;
+
+/**
+ * Load the counters from the counter region, or format it.
+ * @detail Tracks the active firmware region and, if it lies in internal
+ *         flash, the firmware candidate storage. Fails if the counter
+ *         region overlaps a tracked region, the bootloader, the SOTP
+ *         sections or the application details.
+ * @param  flash
+ *             Initialised internal flash, must stay valid while counting.
+ * @return true if the counters are available.
+ */
+bool eraseCounterInit(FlashIAP* flash);
+
+/**
+ * Count an erase of the sector at address.
+ * @detail Call before erasing. Erases of untracked sectors are ignored.
+ * @return false if the counter could not be written.
+ */
+bool eraseCounterRecord(uint32_t address);
+
+/**
+ * Number of recorded erases of the sector at address.
+ * @return false if the sector is not tracked.
+ */
+bool eraseCounterGet(uint32_t address, uint32_t* count);
+
+/**
+ * Wear of a firmware candidate slot in internal flash, which is the count
+ * of its most erased sector.
+ * @return false if candidates are not stored in internal flash.
+ */
+bool eraseCounterGetSlotWear(uint32_t slot, uint32_t* count);
+
+/**
+ * Candidate slot in internal flash with the least wear, for placing the
+ * next candidate. COPROCESSOR_FIRMWARE_SLOT is never returned.
+ * @detail For the application, which chooses the location it prepares.
+ * @return false if candidates are not stored in internal flash.
+ */
+bool eraseCounterGetLeastWornSlot(uint32_t* slot);
+
+/**
+ * Wrap a PAAL to count candidate erases.
+ * @detail Prepare counts an erase of each sector of the slot once the
+ *         wrapped PAAL has accepted it. Every call goes to the location
+ *         it was made for. Calls are passed through unchanged if the
+ *         counters are unavailable. For the application, the bootloader
+ *         only reads candidates.
+ * @param  paal
+ *             PAAL to forward to, must stay valid.
+ * @return PAAL to pass to ARM_UCP_SetPAALUpdate.
+ */
+const ARM_UC_PAAL_UPDATE* eraseCounterWrapPAAL(const ARM_UC_PAAL_UPDATE* paal);
+
+#endif // ERASE_COUNTER_H
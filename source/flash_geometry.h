@@ -0,0 +1,101 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef FLASH_GEOMETRY_H
+#define FLASH_GEOMETRY_H
+
+#include "mbed.h"
+
+#include <stdint.h>
+
+/**
+ * Flash geometry fixed at compile time.
+ * @detail Used for parts with a uniform sector size. Both sizes must be
+ *         powers of two, so page rounding compiles to masks and sector
+ *         walks to constant additions.
+ */
+template <uint32_t PAGE_SIZE, uint32_t SECTOR_SIZE>
+class FixedFlashGeometry
+{
+public:
+    FixedFlashGeometry(FlashIAP&)
+    {
+        /* fails to compile if a size is not a power of two */
+        (void) sizeof(char[((PAGE_SIZE != 0) &&
+                            ((PAGE_SIZE & (PAGE_SIZE - 1)) == 0)) ? 1 : -1]);
+        (void) sizeof(char[((SECTOR_SIZE != 0) &&
+                            ((SECTOR_SIZE & (SECTOR_SIZE - 1)) == 0)) ? 1 : -1]);
+    }
+
+    uint32_t getPageSize() const
+    {
+        return PAGE_SIZE;
+    }
+
+    uint32_t getSectorSize(uint32_t) const
+    {
+        return SECTOR_SIZE;
+    }
+
+    uint32_t roundUpToPage(uint32_t size) const
+    {
+        return (size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    }
+};
+
+/**
+ * Flash geometry queried from FlashIAP.
+ * @detail Fallback for parts with variable sector sizes or without
+ *         configured sizes.
+ */
+class RuntimeFlashGeometry
+{
+public:
+    RuntimeFlashGeometry(FlashIAP& flash) : _flash(flash)
+    {
+    }
+
+    uint32_t getPageSize() const
+    {
+        return _flash.get_page_size();
+    }
+
+    uint32_t getSectorSize(uint32_t address) const
+    {
+        return _flash.get_sector_size(address);
+    }
+
+    uint32_t roundUpToPage(uint32_t size) const
+    {
+        const uint32_t pageSize = _flash.get_page_size();
+
+        return (size + pageSize - 1) / pageSize * pageSize;
+    }
+
+private:
+    FlashIAP& _flash;
+};
+
+#if defined(MBED_CONF_APP_FLASH_PAGE_SIZE) && defined(MBED_CONF_APP_FLASH_SECTOR_SIZE)
+typedef FixedFlashGeometry<MBED_CONF_APP_FLASH_PAGE_SIZE,
+                           MBED_CONF_APP_FLASH_SECTOR_SIZE> ActiveFlashGeometry;
+#else
+typedef RuntimeFlashGeometry ActiveFlashGeometry;
+#endif
+
+#endif // FLASH_GEOMETRY_H
@@ -0,0 +1,103 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+#ifndef IMAGE_RECORD_H
+#define IMAGE_RECORD_H
+
+#include <stdint.h>
+#include "bootloader_common.h"
+#include "blake2s.h"
+
+/* Distance in bytes between SHA-256 midstate checkpoints in the active image */
+#ifndef IMAGE_RECORD_CHECKPOINT_INTERVAL
+#define IMAGE_RECORD_CHECKPOINT_INTERVAL (64 * 1024)
+#endif
+
+/* a midstate can only be captured on a SHA-256 block boundary */
+#if (IMAGE_RECORD_CHECKPOINT_INTERVAL == 0) || \
+    (IMAGE_RECORD_CHECKPOINT_INTERVAL % 64 != 0)
+#error "IMAGE_RECORD_CHECKPOINT_INTERVAL must be a multiple of 64"
+#endif
+
+/* RAM reserved for the record. The record is further limited by the space
+   left in the metadata header region after the internal header. */
+#ifndef IMAGE_RECORD_MAX_SIZE
+#define IMAGE_RECORD_MAX_SIZE 1024
+#endif
+
+#define IMAGE_RECORD_MAGIC   0x42524543
+#define IMAGE_RECORD_VERSION 3
+
+/* Digest used for full checks of the active image at boot. The image is
+   always verified with the SHA-256 from its header before the record is
+   written, the record digest only replaces subsequent full checks. */
+#define IMAGE_RECORD_DIGEST_SHA256  0
+#define IMAGE_RECORD_DIGEST_BLAKE2S 1
+
+#ifndef IMAGE_RECORD_DIGEST
+#if BLAKE2S_ENABLED
+#define IMAGE_RECORD_DIGEST IMAGE_RECORD_DIGEST_BLAKE2S
+#else
+#define IMAGE_RECORD_DIGEST IMAGE_RECORD_DIGEST_SHA256
+#endif
+#endif
+
+#if (IMAGE_RECORD_DIGEST != IMAGE_RECORD_DIGEST_SHA256) && \
+    (IMAGE_RECORD_DIGEST != IMAGE_RECORD_DIGEST_BLAKE2S)
+#error "IMAGE_RECORD_DIGEST must be IMAGE_RECORD_DIGEST_SHA256 or IMAGE_RECORD_DIGEST_BLAKE2S"
+#endif
+
+#if (IMAGE_RECORD_DIGEST == IMAGE_RECORD_DIGEST_BLAKE2S) && !BLAKE2S_ENABLED
+#error "IMAGE_RECORD_DIGEST_BLAKE2S needs blake2s-enabled in mbed_app.json"
+#endif
+
+/**
+ * SHA-256 internal state after hashing a whole number of checkpoint
+ * intervals. The byte count is implied by the checkpoint index.
+ */
+typedef struct {
+    uint32_t state[8];
+} image_record_checkpoint_t;
+
+/**
+ * Verified-image record.
+ * @detail Programmed into the metadata header region, directly after the
+ *         internal header, once the active image has passed a full hash
+ *         check. The checkpoint array follows the structure, followed by
+ *         one CRC-32 per repair block. A repair block is sectorsPerBlock
+ *         consecutive flash sectors counted from the metadata header
+ *         address, and its CRC covers the image bytes inside it. digest
+ *         holds the image digest of type digestType, unused for SHA-256
+ *         where imageHash applies. The record is erased together with the
+ *         header whenever a new image is installed.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t imageSize;
+    uint32_t checkpointInterval;
+    uint32_t checkpointCount;
+    uint32_t sectorsPerBlock;
+    uint32_t repairBlockCount;
+    uint8_t  imageHash[SIZEOF_SHA256];
+    uint32_t digestType;
+    uint8_t  digest[SIZEOF_SHA256];
+    uint32_t crc;
+} image_record_t;
+
+#endif // IMAGE_RECORD_H
@@ -43,6 +43,10 @@
 #include "firmware_update_test.h"
 #endif
 
+#if defined(DIGEST_BENCHMARK) && (DIGEST_BENCHMARK == 1)
+#include "digest_benchmark.h"
+#endif
+
 const arm_uc_installer_details_t bootloader = {
     .arm_hash = BOOTLOADER_ARM_SOURCE_HASH,
     .oem_hash = BOOTLOADER_OEM_SOURCE_HASH,
@@ -56,20 +60,47 @@ extern ARM_UC_PAAL_UPDATE MBED_CLOUD_CLIENT_UPDATE_STORAGE;
 #endif
 
 #if MBED_CLOUD_CLIENT_UPDATE_STORAGE == ARM_UCP_FLASHIAP_BLOCKDEVICE
+#if defined(MBED_CONF_APP_NAND_SPI_MOSI) && defined(MBED_CONF_APP_NAND_SPI_MISO) && \
+    defined(MBED_CONF_APP_NAND_SPI_CLK)  && defined(MBED_CONF_APP_NAND_SPI_CS)
+#include "SPINANDBlockDevice.h"
+
+/* initialise spi nand blockdevice */
+SPINANDBlockDevice nand(MBED_CONF_APP_NAND_SPI_MOSI, MBED_CONF_APP_NAND_SPI_MISO,
+                        MBED_CONF_APP_NAND_SPI_CLK,  MBED_CONF_APP_NAND_SPI_CS);
+
+BlockDevice* arm_uc_blockdevice = &nand;
+#else
+#if defined(MBED_CONF_APP_SD_CRC_READ) && MBED_CONF_APP_SD_CRC_READ
+#include "SDCRCBlockDevice.h"
+
+/* sd card blockdevice with CRC checked reads */
+#define SD_BLOCK_DEVICE SDCRCBlockDevice
+#else
 #include "SDBlockDevice.h"
 
+#define SD_BLOCK_DEVICE SDBlockDevice
+#endif
+
 /* initialise sd card blockdevice */
 #if defined(MBED_CONF_APP_SPI_MOSI) && defined(MBED_CONF_APP_SPI_MISO) && \
     defined(MBED_CONF_APP_SPI_CLK)  && defined(MBED_CONF_APP_SPI_CS)
-SDBlockDevice sd(MBED_CONF_APP_SPI_MOSI, MBED_CONF_APP_SPI_MISO,
-                 MBED_CONF_APP_SPI_CLK,  MBED_CONF_APP_SPI_CS);
+SD_BLOCK_DEVICE sd(MBED_CONF_APP_SPI_MOSI, MBED_CONF_APP_SPI_MISO,
+                   MBED_CONF_APP_SPI_CLK,  MBED_CONF_APP_SPI_CS);
 #else
-SDBlockDevice sd(MBED_CONF_SD_SPI_MOSI, MBED_CONF_SD_SPI_MISO,
-                 MBED_CONF_SD_SPI_CLK,  MBED_CONF_SD_SPI_CS);
+SD_BLOCK_DEVICE sd(MBED_CONF_SD_SPI_MOSI, MBED_CONF_SD_SPI_MISO,
+                   MBED_CONF_SD_SPI_CLK,  MBED_CONF_SD_SPI_CS);
 #endif
 
 BlockDevice* arm_uc_blockdevice = &sd;
 #endif
+#endif
+
+#if defined(COPROCESSOR_FIRMWARE_SLOT)
+/* link to the coprocessor loader */
+SerialCoprocessorTransport coprocessor(MBED_CONF_APP_COPROCESSOR_TX,
+                                       MBED_CONF_APP_COPROCESSOR_RX,
+                                       MBED_CONF_APP_COPROCESSOR_BAUD_RATE);
+#endif
 
 int main(void)
 {
@@ -133,6 +164,10 @@ int main(void)
             bootloader.layout,
             (uint32_t) &bootloader);
 
+#if defined(DIGEST_BENCHMARK) && (DIGEST_BENCHMARK == 1)
+    digest_benchmark_run();
+#endif
+
     /*************************************************************************/
     /* Update                                                                */
     /*************************************************************************/
@@ -151,11 +186,21 @@ int main(void)
             /* Try to update firmware from journal */
             canForward = upgradeApplicationFromStorage();
 
+#if defined(COPROCESSOR_FIRMWARE_SLOT)
+            /* coprocessor failures do not prevent booting the application */
+            upgradeCoprocessorFromStorage(&coprocessor);
+#endif
+
             /* deinit storage driver */
             activeStorageDeinit();
         }
     }
 
+#if ENERGY_ACCOUNTING == 1
+    /* report whether or not there is an application to forward to */
+    printEnergyReport("Boot", NULL);
+#endif
+
     /* forward control to ACTIVE application if it is deemed sane */
     if (canForward)
     {
@@ -173,6 +218,7 @@ int main(void)
         tr_info("Application's start address: 0x%" PRIX32, app_start_addr);
         tr_info("Application's jump address: 0x%" PRIX32, app_jump_addr);
         tr_info("Application's stack address: 0x%" PRIX32, app_stack_ptr);
+
         tr_info("Forwarding to application...\r\n");
 
         mbed_start_application(app_start_addr);
@@ -39,6 +39,14 @@
 #include "firmware_update_test.h"
 #endif
 
+#if defined(COPROCESSOR_FIRMWARE_SLOT)
+#include "coprocessor.h"
+
+#if COPROCESSOR_FIRMWARE_SLOT >= MAX_FIRMWARE_LOCATIONS
+#error "COPROCESSOR_FIRMWARE_SLOT must be a storage location"
+#endif
+#endif
+
 #ifndef MAX_FIRMWARE_LOCATIONS
 #define MAX_FIRMWARE_LOCATIONS             1
 #endif
@@ -119,6 +127,9 @@ bool checkStoredApplication(uint32_t source,
             {
                 /* update hash */
                 mbedtls_sha256_update(&mbedtls_ctx, buffer.ptr, buffer.size);
+                ENERGY_COUNT(storageRead, buffer.size);
+                ENERGY_COUNT(storageReadCalls, 1);
+                ENERGY_COUNT(sha256, buffer.size);
 
                 offset += buffer.size;
             }
@@ -287,6 +298,14 @@ bool upgradeApplicationFromStorage(void)
 
     for (uint32_t index = 0; index < MAX_FIRMWARE_LOCATIONS; index++)
     {
+#if defined(COPROCESSOR_FIRMWARE_SLOT)
+        /* coprocessor firmware is never installed in the active region */
+        if (index == COPROCESSOR_FIRMWARE_SLOT)
+        {
+            continue;
+        }
+#endif
+
         /* clear most recent UCP event */
         event_callback = CLEAR_EVENT;
 
@@ -401,9 +420,17 @@ bool upgradeApplicationFromStorage(void)
             tr_info("Update active firmware using slot %" PRIu32 ":",
                     bestStoredFirmwareIndex);
 
+#if ENERGY_ACCOUNTING == 1
+            energy_counters_t installStart = energyCounters;
+#endif
+
             activeFirmwareValid = copyStoredApplication(bestStoredFirmwareIndex,
                                                         &bestStoredFirmwareImageDetails);
 
+#if ENERGY_ACCOUNTING == 1
+            printEnergyReport("Install", &installStart);
+#endif
+
             /* if image is valid, break out from loop */
             if (activeFirmwareValid)
             {
@@ -431,3 +458,106 @@ bool upgradeApplicationFromStorage(void)
     // return the integrity of the active image
     return activeFirmwareValid;
 }
+
+#if defined(COPROCESSOR_FIRMWARE_SLOT)
+/**
+ * Forward newer firmware in the coprocessor slot to the coprocessor
+ * @param  transport
+ *             Link to the coprocessor loader.
+ * @return true if the coprocessor runs the newest valid firmware.
+ */
+bool upgradeCoprocessorFromStorage(CoprocessorTransport* transport)
+{
+    const uint32_t index = COPROCESSOR_FIRMWARE_SLOT;
+
+    arm_uc_firmware_details_t imageDetails = {
+        .version  = 0,
+        .size     = 0,
+        .hash     = { 0 },
+        .campaign = { 0 }
+    };
+
+    /* clear most recent UCP event */
+    event_callback = CLEAR_EVENT;
+
+    arm_uc_error_t ucp_status = ARM_UCP_GetFirmwareDetails(index,
+                                                           &imageDetails);
+
+    /* wait for event if the call is accepted */
+    if (ucp_status.error == ERR_NONE)
+    {
+        while (event_callback == CLEAR_EVENT)
+        {
+            __WFI();
+        }
+    }
+
+    if ((event_callback != ARM_UC_PAAL_EVENT_GET_FIRMWARE_DETAILS_DONE) ||
+        (imageDetails.size == 0))
+    {
+        tr_info("Slot %" PRIu32 " is empty", index);
+
+        return true;
+    }
+
+    uint64_t installedVersion = 0;
+
+    if (transport->getVersion(&installedVersion))
+    {
+        tr_info("Coprocessor version: %" PRIu64, installedVersion);
+
+        if (imageDetails.version <= installedVersion)
+        {
+            tr_info("Coprocessor firmware up-to-date");
+
+            return true;
+        }
+    }
+#if COPROCESSOR_FORCE_UPDATE
+    else
+    {
+        tr_warning("Coprocessor version unknown, forcing update");
+    }
+#else
+    else
+    {
+        /* installing it anyway would reflash the coprocessor on every boot */
+        tr_warning("Coprocessor version unknown, not updated");
+
+        return true;
+    }
+#endif
+
+    tr_info("Slot %" PRIu32 " firmware integrity check:", index);
+
+    if (!checkStoredApplication(index, &imageDetails))
+    {
+        tr_error("Slot %" PRIu32 " firmware integrity check failed", index);
+
+        return false;
+    }
+
+    bool result = false;
+
+    for (uint32_t retries = 0;
+         (retries < COPROCESSOR_MAX_RETRIES) && !result;
+         retries++)
+    {
+        tr_info("Update coprocessor firmware using slot %" PRIu32 ":", index);
+
+        result = forwardCoprocessorFirmware(index, &imageDetails, transport);
+
+        if (result)
+        {
+            tr_info("Coprocessor firmware updated to version %" PRIu64,
+                    imageDetails.version);
+        }
+        else
+        {
+            tr_error("Coprocessor firmware update failed");
+        }
+    }
+
+    return result;
+}
+#endif
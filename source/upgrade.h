@@ -30,3 +30,15 @@ extern uint8_t* bootCounter;
  * @return true if the active firmware region is valid.
  */
 bool upgradeApplicationFromStorage(void);
+
+#if defined(COPROCESSOR_FIRMWARE_SLOT)
+#include "coprocessor.h"
+
+/**
+ * Forward newer firmware in the coprocessor slot to the coprocessor
+ * @param  transport
+ *             Link to the coprocessor loader.
+ * @return true if the coprocessor runs the newest valid firmware.
+ */
+bool upgradeCoprocessorFromStorage(CoprocessorTransport* transport);
+#endif
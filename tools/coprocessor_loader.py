@@ -0,0 +1,165 @@
+#!/usr/bin/env python
+# ----------------------------------------------------------------------------
+# Copyright 2018 ARM Ltd.
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ----------------------------------------------------------------------------
+
+"""
+Stand-in for the coprocessor loader, running on a Linux host.
+
+Answers the UART protocol of SerialCoprocessorTransport (source/coprocessor.h)
+on a serial port, or on a new pseudo terminal whose path is printed first, so
+the bootloader side can be exercised without coprocessor hardware:
+
+  'V'                          ACK, then the installed version (8 bytes LE)
+  'B' size(4) hash(32)         ACK
+  'D' offset(4) length(2) data crc32(4)
+                               ACK once written, NAK on a bad CRC or offset
+  'E' commit(1)                ACK if committed and the SHA-256 matches
+
+Multi-byte fields are little endian. Committed firmware is written to the
+output file and becomes the installed version.
+"""
+
+from __future__ import print_function
+
+import argparse
+import hashlib
+import os
+import struct
+import sys
+import termios
+import time
+import tty
+import zlib
+
+ACK = b"\x06"
+NAK = b"\x15"
+
+
+class Loader(object):
+    def __init__(self, fd, version, output, report_version=True, delay=0.0):
+        self.fd = fd
+        self.version = version
+        self.output = output
+        self.report_version = report_version
+        self.delay = delay
+        self.size = None
+        self.hash = None
+        self.image = None
+
+    def read(self, length):
+        data = b""
+        while len(data) < length:
+            chunk = os.read(self.fd, length - len(data))
+            if not chunk:
+                raise EOFError()
+            data += chunk
+        return data
+
+    def write(self, data):
+        while data:
+            data = data[os.write(self.fd, data):]
+
+    def handle(self):
+        """ Answer one command, return False after a transfer ended """
+        command = self.read(1)
+
+        if command == b"V":
+            if self.report_version:
+                self.write(ACK + struct.pack("<Q", self.version))
+            else:
+                self.write(NAK)
+        elif command == b"B":
+            self.size, = struct.unpack("<I", self.read(4))
+            self.hash = self.read(32)
+            self.image = bytearray(self.size)
+            self.write(ACK)
+        elif command == b"D":
+            offset, length = struct.unpack("<IH", self.read(6))
+            data = self.read(length)
+            crc, = struct.unpack("<I", self.read(4))
+            valid = self.image is not None and \
+                    offset + length <= self.size and \
+                    zlib.crc32(data) & 0xFFFFFFFF == crc
+            if valid:
+                self.image[offset:offset + length] = data
+                # time taken by the coprocessor to program the chunk
+                time.sleep(self.delay)
+            self.write(ACK if valid else NAK)
+        elif command == b"E":
+            commit = self.read(1) != b"\0"
+            valid = self.image is not None and \
+                    hashlib.sha256(bytes(self.image)).digest() == self.hash
+            if commit and valid:
+                with open(self.output, "wb") as f:
+                    f.write(self.image)
+                self.version += 1
+                print("committed {} bytes".format(self.size))
+            else:
+                print("aborted")
+            sys.stdout.flush()
+            self.image = None
+            self.write(ACK if commit and valid else NAK)
+            return False
+        else:
+            self.write(NAK)
+
+        return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    port = parser.add_mutually_exclusive_group(required=True)
+    port.add_argument("port", nargs="?", help="serial port device")
+    port.add_argument("--pty", action="store_true",
+                      help="create a pseudo terminal and print its path")
+    parser.add_argument("-v", "--version", type=int, default=0,
+                        help="installed firmware version reported to 'V'")
+    parser.add_argument("--no-version", action="store_true",
+                        help="answer 'V' with NAK, like a loader that cannot "
+                             "report the installed version")
+    parser.add_argument("-o", "--output", default="coprocessor.bin",
+                        help="file receiving committed firmware")
+    parser.add_argument("--delay", type=float, default=0.0,
+                        help="seconds spent programming each chunk")
+    parser.add_argument("--once", action="store_true",
+                        help="exit after the first transfer")
+    args = parser.parse_args()
+
+    if args.pty:
+        fd, peer = os.openpty()
+        tty.setraw(peer)
+        # keep the peer open, so reads do not fail between connections
+        print(os.ttyname(peer))
+    else:
+        fd = os.open(args.port, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd, termios.TCSANOW)
+    sys.stdout.flush()
+
+    loader = Loader(fd, args.version, args.output,
+                    report_version=not args.no_version, delay=args.delay)
+
+    try:
+        while loader.handle() or not args.once:
+            pass
+    except (EOFError, KeyboardInterrupt):
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,681 @@
+#!/usr/bin/env python
+# ----------------------------------------------------------------------------
+# Copyright 2018 ARM Ltd.
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ----------------------------------------------------------------------------
+
+"""
+Replay the bootloader decision on flash and storage dumps.
+
+Every device directory holds the internal flash dump 'flash.bin', starting
+at flash-start-address, and, for sd card storage, the block device dump
+'sd.bin'. For every device the tool checks the active firmware and all
+storage slots the same way as upgradeApplicationFromStorage() and reports
+which image the bootloader would boot or install, and why, together with
+the energy estimate of the replayed boot from the cost table of the target.
+
+The boot counter lives in RAM and is not part of a dump, so a fresh boot is
+assumed. External slot headers are authenticated with a device specific
+key; their HMAC is not checked. Internal flash must have a uniform sector
+size, repair blocks are located with a single flash-sector-size.
+
+The decisions mirror upgrade.cpp and active_application.cpp by hand.
+tools/test/test_inspect_dumps.py replays the same fixtures through those
+sources built for the host and fails if the two disagree.
+"""
+
+from __future__ import print_function
+
+import argparse
+import hashlib
+import json
+import multiprocessing
+import os
+import re
+import struct
+import zlib
+
+from package_firmware import ARM_UC_INTERNAL_HEADER_FORMAT_V2, \
+                             ARM_UC_INTERNAL_HEADER_MAGIC_V2
+
+ARM_UC_INTERNAL_HEADER_SIZE_V2 = 112
+
+# firmware version, size and hash share their offsets in the internal and
+# external header formats
+ARM_UC_HEADER_FIRMWARE_FORMAT_V2 = ">8xQQ32s"
+
+# source/image_record.h
+IMAGE_RECORD_MAGIC = 0x42524543
+IMAGE_RECORD_VERSION = 3
+IMAGE_RECORD_FORMAT = "<7I32sI32sI"
+IMAGE_RECORD_DIGEST_BLAKE2S = 1
+
+IMAGE_RECORD_CHECKPOINT_INTERVAL = 64 * 1024
+IMAGE_RECORD_CHECKPOINT_SIZE = 32
+IMAGE_RECORD_MAX_SIZE = 1024
+
+# source/bootloader_common.h
+DEFAULT_BUFFER_SIZE = 16 * 1024
+
+# source/energy.h, bulk costs are per KiB, call costs per call
+ENERGY_COUNTERS = ("storage_read", "storage_read_call", "flash_program",
+                   "flash_program_call", "flash_erase", "sha256", "blake2s",
+                   "uart")
+ENERGY_BULK_COUNTERS = ("storage_read", "flash_program", "sha256", "blake2s")
+
+
+def load_config(path, target):
+    """ Resolve the bootloader layout for a target from mbed_app.json """
+    with open(path) as f:
+        config = json.load(f)
+
+    macros = {}
+    for macro in config.get("macros", []):
+        name, _, value = macro.partition("=")
+        macros[name] = value
+
+    settings = {}
+    for key, value in config.get("config", {}).items():
+        settings[key] = value.get("value")
+    for scope in ("*", target):
+        settings.update(config.get("target_overrides", {}).get(scope, {}))
+
+    for key, value in settings.items():
+        if value is None or key.startswith("target.") or \
+           key.startswith("platform."):
+            continue
+        if "." in key:
+            name = "MBED_CONF_" + key.replace(".", "_").replace("-", "_")
+        else:
+            name = "MBED_CONF_APP_" + key.replace("-", "_")
+        macros[name.upper()] = str(value)
+
+    def resolve(name, depth=0):
+        expression = macros[name]
+        if depth > 16:
+            raise ValueError("recursive definition of " + name)
+        expression = re.sub(r"[A-Z_][A-Z0-9_]*",
+                            lambda m: str(resolve(m.group(0), depth + 1))
+                            if m.group(0) in macros else m.group(0),
+                            expression)
+        return eval(expression, {"__builtins__": {}})
+
+    layout = {
+        "flash_start": resolve("MBED_CONF_APP_FLASH_START_ADDRESS")
+                       if "MBED_CONF_APP_FLASH_START_ADDRESS" in macros else 0,
+        "header_address": resolve("MBED_CONF_UPDATE_CLIENT_APPLICATION_DETAILS"),
+        "app_start": resolve("MBED_CONF_APP_APPLICATION_START_ADDRESS"),
+        "max_app_size": resolve("MBED_CONF_APP_MAX_APPLICATION_SIZE"),
+        "storage_address": resolve("MBED_CONF_UPDATE_CLIENT_STORAGE_ADDRESS"),
+        "storage_size": resolve("MBED_CONF_UPDATE_CLIENT_STORAGE_SIZE"),
+        "locations": resolve("MBED_CONF_UPDATE_CLIENT_STORAGE_LOCATIONS"),
+        "page_size": resolve("MBED_CONF_APP_FLASH_PAGE_SIZE")
+                     if "MBED_CONF_APP_FLASH_PAGE_SIZE" in macros else None,
+        "sector_size": resolve("MBED_CONF_APP_FLASH_SECTOR_SIZE")
+                       if "MBED_CONF_APP_FLASH_SECTOR_SIZE" in macros else None,
+        "coprocessor_slot": resolve("COPROCESSOR_FIRMWARE_SLOT")
+                            if "COPROCESSOR_FIRMWARE_SLOT" in macros else None,
+        "record_blake2s": macros.get("IMAGE_RECORD_DIGEST") ==
+                          "IMAGE_RECORD_DIGEST_BLAKE2S",
+        "energy_costs": dict(
+            (counter, resolve("MBED_CONF_APP_ENERGY_" + counter.upper())
+             if "MBED_CONF_APP_ENERGY_" + counter.upper() in macros else 0)
+            for counter in ENERGY_COUNTERS),
+        "buffer_size": resolve("BUFFER_SIZE")
+                       if "BUFFER_SIZE" in macros else DEFAULT_BUFFER_SIZE,
+        "progress_bar": macros.get("SHOW_PROGRESS_BAR") == "1",
+        "energy_report": macros.get("ENERGY_ACCOUNTING") == "1",
+        "storage": "flash" if macros.get("MBED_CLOUD_CLIENT_UPDATE_STORAGE") ==
+                   "ARM_UCP_FLASHIAP" else "sd",
+    }
+    return layout
+
+
+def check_active(flash, layout):
+    """ Mirror of checkActiveApplication() """
+    offset = layout["header_address"] - layout["flash_start"]
+    header = flash[offset:offset + ARM_UC_INTERNAL_HEADER_SIZE_V2]
+    active = {"status": "error", "version": 0, "size": 0}
+
+    if len(header) < ARM_UC_INTERNAL_HEADER_SIZE_V2:
+        active["reason"] = "header outside of dump"
+        return active
+
+    fields = struct.unpack(ARM_UC_INTERNAL_HEADER_FORMAT_V2, header[:-4])
+    crc, = struct.unpack(">I", header[-4:])
+
+    if fields[0] != ARM_UC_INTERNAL_HEADER_MAGIC_V2 or \
+       crc != zlib.crc32(header[:-4]) & 0xFFFFFFFF:
+        active["reason"] = "no valid header"
+        return active
+
+    version, size, digest = fields[2], fields[3], fields[4][:32]
+    active.update(version=version, size=size, sha256=hex_string(digest))
+
+    if size == 0:
+        active["status"] = "empty"
+        return active
+
+    start = layout["app_start"] - layout["flash_start"]
+    image = flash[start:start + size]
+
+    if len(image) == size and hashlib.sha256(image).digest() == digest:
+        active["status"] = "success"
+    else:
+        active["reason"] = "hash mismatch"
+
+    active["record"] = check_record(flash, layout, header, size, digest)
+    return active
+
+
+def check_record(flash, layout, header, size, digest):
+    """ Mirror of readActiveImageRecord(), reports damaged repair blocks """
+    page = layout["page_size"]
+    offset = layout["header_address"] - layout["flash_start"] + \
+             (len(header) + page - 1) // page * page
+    length = struct.calcsize(IMAGE_RECORD_FORMAT)
+    data = flash[offset:offset + length]
+
+    if len(data) < length or data == b"\xFF" * length:
+        return "absent"
+
+    fields = struct.unpack(IMAGE_RECORD_FORMAT, data)
+    if fields[0] != IMAGE_RECORD_MAGIC or fields[1] != IMAGE_RECORD_VERSION:
+        return "unknown format"
+    if fields[2] != size or fields[7] != digest:
+        return "stale"
+
+    total = length + fields[4] * 32 + fields[6] * 4
+    record = bytearray(flash[offset:offset + total])
+    record[length - 4:length] = b"\0\0\0\0"
+    if zlib.crc32(bytes(record)) & 0xFFFFFFFF != fields[-1]:
+        return "corrupt"
+
+    # repair blocks are counted in sectors from the metadata header address
+    damaged = []
+    digests = struct.unpack("<{}I".format(fields[6]),
+                            flash[offset + length + fields[4] * 32:
+                                  offset + total])
+    block_size = fields[5] * layout["sector_size"]
+    app_start = layout["app_start"] - layout["flash_start"]
+    app_end = app_start + size
+
+    for block, crc in enumerate(digests):
+        block_start = layout["header_address"] - layout["flash_start"] + \
+                      block * block_size
+        start = max(block_start, app_start)
+        end = min(block_start + block_size, app_end)
+        if zlib.crc32(flash[start:max(start, end)]) & 0xFFFFFFFF != crc:
+            damaged.append(block)
+
+    return {"checkpoints": fields[4], "checkpoint_interval": fields[3],
+            "repair_blocks": fields[6], "sectors_per_block": fields[5],
+            "digest_type": fields[8], "damaged_blocks": damaged}
+
+
+def check_slots(flash, sd, layout, active_version, active_valid):
+    """ Mirror of the candidate search in upgradeApplicationFromStorage() """
+    storage = flash if layout["storage"] == "flash" else sd
+    base = layout["storage_address"] - \
+           (layout["flash_start"] if layout["storage"] == "flash" else 0)
+    slot_size = layout["storage_size"] // layout["locations"]
+
+    slots = []
+    best_index = None
+    best_version = active_version if active_valid else 0
+
+    for index in range(layout["locations"]):
+        slot = {"index": index}
+        slots.append(slot)
+
+        if index == layout["coprocessor_slot"]:
+            slot["status"] = "coprocessor firmware"
+            continue
+
+        start = base + index * slot_size
+        header = storage[start:start + struct.calcsize(
+            ARM_UC_HEADER_FIRMWARE_FORMAT_V2)] if storage else b""
+
+        if len(header) < struct.calcsize(ARM_UC_HEADER_FIRMWARE_FORMAT_V2) or \
+           header in (b"\xFF" * len(header), b"\0" * len(header)):
+            slot["status"] = "empty"
+            continue
+
+        version, size, digest = struct.unpack(ARM_UC_HEADER_FIRMWARE_FORMAT_V2,
+                                              header)
+        slot.update(version=version, size=size, sha256=hex_string(digest))
+
+        if not (version > best_version and size > 0 and
+                (version != active_version or not active_valid)):
+            slot["status"] = "older"
+            continue
+
+        body = start + layout["slot_header_size"]
+        image = storage[body:body + size]
+
+        if len(image) != size or hashlib.sha256(image).digest() != digest:
+            slot["status"] = "integrity check failed"
+        elif size > layout["max_app_size"]:
+            slot["status"] = "too large"
+        else:
+            slot["status"] = "valid"
+            best_index = index
+            best_version = version
+
+    return slots, best_index
+
+
+def round_up(size, unit):
+    return (size + unit - 1) // unit * unit
+
+
+def energy_estimate(counts, costs):
+    """ Mirror of energyEstimate() in source/energy.c, in nJ """
+    bulk = sum(counts[c] * costs[c] for c in ENERGY_BULK_COUNTERS)
+
+    return bulk // 1024 + \
+           sum(counts[c] * costs[c] for c in ENERGY_COUNTERS
+               if c not in ENERGY_BULK_COUNTERS)
+
+
+def plan_record(size, layout):
+    """ Mirror of planActiveImageRecord(), for a record built from scratch """
+    used = round_up(ARM_UC_INTERNAL_HEADER_SIZE_V2, layout["page_size"])
+    capacity = min(max(0, layout["app_start"] - layout["header_address"] - used),
+                   IMAGE_RECORD_MAX_SIZE)
+    plan = {"capacity": capacity, "checkpoints": 0, "sectors_per_block": 0,
+            "repair_blocks": 0}
+    space = capacity - struct.calcsize(IMAGE_RECORD_FORMAT)
+
+    if space <= 0:
+        return plan
+
+    plan["checkpoints"] = min((size - 1) // IMAGE_RECORD_CHECKPOINT_INTERVAL,
+                              space // IMAGE_RECORD_CHECKPOINT_SIZE)
+    space -= plan["checkpoints"] * IMAGE_RECORD_CHECKPOINT_SIZE
+
+    sectors = -(-(layout["app_start"] + size - layout["header_address"]) //
+                layout["sector_size"])
+    digests = space // 4
+    if digests > 0:
+        plan["sectors_per_block"] = -(-sectors // digests)
+        plan["repair_blocks"] = -(-sectors // plan["sectors_per_block"])
+
+    return plan
+
+
+def record_size(record):
+    return struct.calcsize(IMAGE_RECORD_FORMAT) + \
+           record["checkpoints"] * IMAGE_RECORD_CHECKPOINT_SIZE + \
+           record["repair_blocks"] * 4
+
+
+class BootReplay(object):
+    """
+    Operation counts and printed bytes along the path the bootloader takes.
+
+    Mirrors the ENERGY_COUNT() calls and the log of
+    upgradeApplicationFromStorage(), assuming every operation succeeds at
+    the first attempt. Only the length of printed lines matters, so digests
+    are printed as placeholders.
+    """
+
+    def __init__(self, layout):
+        self.layout = layout
+        self.counts = dict.fromkeys(ENERGY_COUNTERS, 0)
+        self.last_percent = 0
+
+    def snapshot(self):
+        return dict(self.counts)
+
+    def delta(self, start):
+        return dict((c, self.counts[c] - start[c]) for c in ENERGY_COUNTERS)
+
+    def info(self, text):
+        self.counts["uart"] += len("[BOOT] " + text + "\r\n")
+
+    def error(self, text):
+        self.counts["uart"] += len("[ERR ] " + text + "\r\n")
+
+    def digest(self, name="SHA256"):
+        self.info(name + ": " + "0" * 64)
+
+    def progress(self, progress, total):
+        """ Mirror of printProgress(), which remembers the last percentage """
+        if not self.layout["progress_bar"]:
+            return
+        percent = (progress * 70 // total) & 0xFF
+        if percent != self.last_percent:
+            self.last_percent = percent
+            self.counts["uart"] += len("\r[BOOT] [") + 70 + \
+                                   (3 if progress >= total else 1)
+
+    def energy_report(self, label, start):
+        """ Mirror of printEnergyReport() """
+        if not self.layout["energy_report"]:
+            return
+        delta = self.delta(start)
+        energy = energy_estimate(delta, self.layout["energy_costs"])
+        self.info("{} energy: {} uJ".format(label, (energy // 1000) & 0xFFFFFFFF))
+        self.info("Read {} B in {} calls, programmed {} B in {} calls, "
+                  "erased {} sectors".format(
+                      delta["storage_read"], delta["storage_read_call"],
+                      delta["flash_program"], delta["flash_program_call"],
+                      delta["flash_erase"]))
+        self.info("SHA-256 {} B, BLAKE2s {} B, UART {} B".format(
+            delta["sha256"], delta["blake2s"], delta["uart"]))
+
+    def program(self, size):
+        self.counts["flash_program"] += size
+        self.counts["flash_program_call"] += 1
+
+    def check_stored(self, size):
+        """ Mirror of checkStoredApplication() """
+        offset = 0
+        while offset < size:
+            chunk = min(self.layout["buffer_size"], size - offset)
+            self.counts["storage_read"] += chunk
+            self.counts["storage_read_call"] += 1
+            self.counts["sha256"] += chunk
+            offset += chunk
+            self.progress(offset, size)
+
+    def hash_active(self, size, plan=None, fast=False):
+        """ Mirror of the hash loop of checkActiveApplicationFrom() """
+        block_size = (plan or {}).get("sectors_per_block", 0) * \
+                     self.layout["sector_size"]
+        block_end = self.layout["header_address"] + block_size
+        block_index = 0
+        app_start = self.layout["app_start"]
+        offset = 0
+
+        while offset < size:
+            chunk = min(self.layout["buffer_size"], size - offset)
+
+            if plan is not None:
+                # a record is built, stop on checkpoints and repair blocks
+                boundary = (offset // IMAGE_RECORD_CHECKPOINT_INTERVAL + 1) * \
+                           IMAGE_RECORD_CHECKPOINT_INTERVAL
+                chunk = min(chunk, boundary - offset)
+
+                if plan["repair_blocks"] > 0:
+                    while block_end <= app_start + offset and \
+                          block_index < plan["repair_blocks"]:
+                        block_index += 1
+                        block_end += block_size
+                    if block_end > app_start + offset:
+                        chunk = min(chunk, block_end - (app_start + offset))
+
+            self.counts["blake2s" if fast else "sha256"] += chunk
+            offset += chunk
+
+            if plan is not None and self.layout["record_blake2s"]:
+                self.counts["blake2s"] += chunk
+
+            self.progress(offset, size)
+
+    def write_range(self, size, start, end):
+        """ Mirror of writeActiveFirmwareRange() """
+        page = self.layout["page_size"]
+        read_size = self.layout["buffer_size"] // page * page
+        offset = start
+
+        while offset < end:
+            chunk = min(read_size, end - offset)
+            self.counts["storage_read"] += chunk
+            self.counts["storage_read_call"] += 1
+
+            program_size = round_up(chunk, page)
+            for program_offset in range(page, program_size + 1, page):
+                self.program(page)
+                self.progress(offset + program_offset, size)
+
+            offset += program_size
+
+    def write_record(self, plan):
+        """ Mirror of writeActiveImageRecord() on an erased record region """
+        program_size = round_up(record_size(plan), self.layout["page_size"])
+        if program_size <= plan["capacity"]:
+            self.program(program_size)
+
+
+def replay_energy(active, slots, best, layout):
+    """
+    Operation counts of the replayed boot and install.
+
+    The printed bytes cover the log of upgradeApplicationFromStorage(), not
+    the banner printed before it. Erase counter updates are not replayed.
+    """
+    replay = BootReplay(layout)
+    record = active.get("record")
+    repair = False
+    page = layout["page_size"]
+    sector = layout["sector_size"]
+    header_size = round_up(ARM_UC_INTERNAL_HEADER_SIZE_V2, page)
+    app_offset = layout["app_start"] - layout["header_address"]
+
+    # checkActiveApplication(), the record digest replaces SHA-256
+    replay.info("Active firmware integrity check:")
+
+    if active["size"] > 0:
+        fast = isinstance(record, dict) and \
+               record["digest_type"] == IMAGE_RECORD_DIGEST_BLAKE2S
+        plan = None if isinstance(record, dict) else \
+               plan_record(active["size"], layout)
+
+        replay.hash_active(active["size"], plan=plan, fast=fast)
+
+        if active["status"] == "success":
+            if record == "absent":
+                replay.write_record(plan)
+        else:
+            replay.digest("BLAKE2s" if fast else "SHA256")
+            replay.digest("BLAKE2s" if fast else "SHA256")
+
+    if active["status"] == "success":
+        replay.digest()
+        replay.info("Version: {}".format(active["version"]))
+    elif active["status"] == "empty":
+        replay.info("Active firmware slot is empty")
+    else:
+        replay.error("Active firmware integrity check failed")
+
+    # candidate search
+    for slot in slots:
+        index = slot["index"]
+
+        if slot["status"] == "empty":
+            replay.info("Slot {} is empty".format(index))
+        elif slot["status"] == "older":
+            replay.info("Slot {} firmware is of older date".format(index))
+            replay.info("Version: {}".format(slot["version"]))
+        elif slot["status"] != "coprocessor firmware":
+            replay.info("Slot {} firmware integrity check:".format(index))
+            replay.check_stored(slot["size"])
+
+            if slot["status"] == "integrity check failed":
+                replay.digest()
+                replay.digest()
+                replay.error("Slot {} firmware integrity check failed".format(
+                    index))
+            else:
+                replay.digest()
+                replay.info("Version: {}".format(slot["version"]))
+                if slot["status"] == "too large":
+                    replay.error("Slot {} firmware size too large {} > {}"
+                                 .format(index, slot["size"],
+                                         layout["max_app_size"]))
+
+    install_start = replay.snapshot()
+    install = dict.fromkeys(ENERGY_COUNTERS, 0)
+
+    if best is not None:
+        candidate = slots[best]
+        size = candidate["size"]
+
+        replay.info("Update active firmware using slot {}:".format(best))
+        install_start = replay.snapshot()
+
+        repair = isinstance(record, dict) and record["damaged_blocks"] and \
+                 active["status"] != "success" and active["size"] == size and \
+                 active.get("sha256") == candidate["sha256"]
+
+        if repair:
+            # repairActiveFirmware(), then verify the whole image
+            block_size = record["sectors_per_block"] * sector
+
+            for block in record["damaged_blocks"]:
+                block_start = layout["header_address"] + block * block_size
+                replay.info("Repair active firmware from 0x{:08X} to 0x{:08X}"
+                            .format(block_start, block_start + block_size))
+                replay.counts["flash_erase"] += record["sectors_per_block"]
+                if block == 0:
+                    replay.program(header_size)
+                    replay.program(round_up(record_size(record), page))
+
+                start = max(block * block_size, app_offset) - app_offset
+                end = min((block + 1) * block_size, app_offset + size) - \
+                      app_offset
+                replay.write_range(size, start, max(start, end))
+
+            replay.info("Verify repaired active firmware:")
+            replay.hash_active(size, fast=record["digest_type"] ==
+                               IMAGE_RECORD_DIGEST_BLAKE2S)
+            replay.info("Active firmware repaired")
+        else:
+            # eraseActiveFirmware(), writeActiveFirmware(), then verify and
+            # write the record into the erased header region
+            replay.counts["flash_erase"] += (app_offset + size + sector - 1) // \
+                                            sector
+            replay.program(header_size)
+            replay.write_range(size, 0, size)
+
+            plan = plan_record(size, layout)
+            replay.info("Verify new active firmware:")
+            replay.hash_active(size, plan=plan)
+            replay.write_record(plan)
+
+        install = replay.delta(install_start)
+        replay.energy_report("Install", install_start)
+        replay.info("New active firmware is valid")
+    elif active["status"] == "success":
+        replay.info("Active firmware up-to-date")
+    else:
+        replay.error("Active firmware invalid")
+
+    boot = replay.snapshot()
+
+    costs = layout["energy_costs"]
+    boot["uJ"] = energy_estimate(boot, costs) // 1000
+    install["uJ"] = energy_estimate(install, costs) // 1000
+
+    return {"boot": boot, "install": install}, bool(repair)
+
+
+def inspect(task):
+    """ Replay the boot decision for one device, runs in a worker process """
+    directory, layout = task
+    report = {"device": os.path.basename(os.path.normpath(directory))}
+
+    try:
+        with open(os.path.join(directory, "flash.bin"), "rb") as f:
+            flash = f.read()
+        sd = b""
+        if os.path.exists(os.path.join(directory, "sd.bin")):
+            with open(os.path.join(directory, "sd.bin"), "rb") as f:
+                sd = f.read()
+    except IOError as e:
+        report["decision"] = "error: " + str(e)
+        return report
+
+    active = check_active(flash, layout)
+    active_valid = active["status"] == "success"
+    slots, best = check_slots(flash, sd, layout, active["version"],
+                              active_valid)
+
+    report["energy"], repair = replay_energy(active, slots, best, layout)
+
+    if repair:
+        report["decision"] = "repair active firmware from slot {}".format(best)
+    elif best is not None:
+        report["decision"] = "install slot {}".format(best)
+    elif active_valid:
+        report["decision"] = "boot active firmware"
+    else:
+        report["decision"] = "no valid firmware"
+
+    report["active"] = active
+    report["slots"] = slots
+    return report
+
+
+def hex_string(data):
+    return "".join("{:02X}".format(c) for c in bytearray(data))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("devices", nargs="+",
+                        help="device directories with flash.bin and sd.bin")
+    parser.add_argument("-m", "--target", required=True,
+                        help="target name in the configuration")
+    parser.add_argument("--app-config", default="mbed_app.json",
+                        help="bootloader configuration")
+    parser.add_argument("--page-size", type=int, default=None,
+                        help="internal flash page size, if not configured")
+    parser.add_argument("--sector-size", type=int, default=None,
+                        help="uniform internal flash sector size, if not "
+                             "configured")
+    parser.add_argument("--slot-header-size", type=int, default=512,
+                        help="bytes reserved for the header at the start of "
+                             "each storage slot")
+    parser.add_argument("-o", "--output", default=None,
+                        help="write the full JSON report to this file")
+    parser.add_argument("-j", "--jobs", type=int,
+                        default=multiprocessing.cpu_count(),
+                        help="number of worker processes")
+    args = parser.parse_args()
+
+    layout = load_config(args.app_config, args.target)
+    layout["slot_header_size"] = args.slot_header_size
+    for key in ("page_size", "sector_size"):
+        if layout[key] is None:
+            layout[key] = getattr(args, key)
+        if layout[key] is None:
+            parser.error("{} is not configured for {}, use --{}".format(
+                key, args.target, key.replace("_", "-")))
+
+    pool = multiprocessing.Pool(args.jobs)
+    reports = pool.map(inspect, [(d, layout) for d in args.devices],
+                       chunksize=8)
+    pool.close()
+    pool.join()
+
+    for report in reports:
+        if "energy" in report:
+            print("{}: {}, {} uJ".format(report["device"], report["decision"],
+                                         report["energy"]["boot"]["uJ"]))
+        else:
+            print("{}: {}".format(report["device"], report["decision"]))
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(reports, f, indent=4, sort_keys=True)
+
+
+if __name__ == "__main__":
+    main()
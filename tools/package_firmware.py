@@ -0,0 +1,178 @@
+#!/usr/bin/env python
+# ----------------------------------------------------------------------------
+# Copyright 2018 ARM Ltd.
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ----------------------------------------------------------------------------
+
+"""
+Package application binaries into bootloader candidates.
+
+For every input binary the tool writes:
+  <name>.bin            the raw firmware image
+  <name>.hdr            internal metadata header v2 for the image
+  <name>.manifest.json  size, SHA-256 and per-chunk SHA-256/CRC-32 digests
+
+Chunk digests of all inputs are computed in parallel on all cores.
+"""
+
+from __future__ import print_function
+
+import argparse
+import binascii
+import collections
+import hashlib
+import json
+import multiprocessing
+import os
+import shutil
+import struct
+import uuid
+import zlib
+
+# arm_uc_metadata_header_v2.h
+ARM_UC_INTERNAL_HEADER_MAGIC_V2 = 0x5A51B3D4
+ARM_UC_INTERNAL_HEADER_VERSION_V2 = 2
+ARM_UC_SHA512_SIZE = 64
+ARM_UC_GUID_SIZE = 16
+ARM_UC_INTERNAL_HEADER_FORMAT_V2 = ">2I2Q{}s{}sI".format(ARM_UC_SHA512_SIZE,
+                                                        ARM_UC_GUID_SIZE)
+
+# source/image_record.h
+IMAGE_RECORD_CHECKPOINT_INTERVAL = 64 * 1024
+
+
+def create_internal_header(version, size, sha256, campaign):
+    """ Internal header v2 as written by arm_uc_create_internal_header_v2 """
+    header = struct.pack(ARM_UC_INTERNAL_HEADER_FORMAT_V2,
+                         ARM_UC_INTERNAL_HEADER_MAGIC_V2,
+                         ARM_UC_INTERNAL_HEADER_VERSION_V2,
+                         version,
+                         size,
+                         sha256,
+                         campaign,
+                         0)
+    return header + struct.pack(">I", zlib.crc32(header) & 0xFFFFFFFF)
+
+
+def digest_chunk(task):
+    """ Digest one chunk of an input file, runs in a worker process """
+    path, offset, size = task
+    with open(path, "rb") as f:
+        f.seek(offset)
+        data = f.read(size)
+    return (path, offset, hashlib.sha256(data).hexdigest(),
+            zlib.crc32(data) & 0xFFFFFFFF)
+
+
+def digest_image(path):
+    """ Digest a whole input file, runs in a worker process """
+    with open(path, "rb") as f:
+        return (path, hashlib.sha256(f.read()).digest())
+
+
+def output_name(path):
+    """ Name of the outputs for an input binary """
+    return os.path.splitext(os.path.basename(path))[0]
+
+
+def package(args):
+    pool = multiprocessing.Pool(args.jobs)
+
+    # split every input into chunks, and hash whole images alongside
+    tasks = []
+    for path in args.input:
+        size = os.path.getsize(path)
+        tasks += [(path, offset, min(args.chunk_size, size - offset))
+                  for offset in range(0, size, args.chunk_size)]
+
+    images = pool.map_async(digest_image, args.input)
+    chunks = pool.map(digest_chunk, tasks, chunksize=16)
+    images = dict(images.get())
+
+    pool.close()
+    pool.join()
+
+    # chunks come back in task order, group them by input once
+    manifests = collections.OrderedDict((path, []) for path in args.input)
+    for (path, offset, sha, crc) in chunks:
+        manifests[path].append({"offset": offset, "sha256": sha, "crc32": crc})
+
+    if not os.path.isdir(args.output):
+        os.makedirs(args.output)
+
+    campaign = uuid.UUID(args.campaign).bytes if args.campaign else \
+               b"\0" * ARM_UC_GUID_SIZE
+
+    for path in args.input:
+        name = output_name(path)
+        base = os.path.join(args.output, name)
+        size = os.path.getsize(path)
+        sha256 = images[path]
+
+        with open(base + ".hdr", "wb") as f:
+            f.write(create_internal_header(args.version, size, sha256, campaign))
+
+        shutil.copyfile(path, base + ".bin")
+
+        manifest = {
+            "version": args.version,
+            "size": size,
+            "sha256": binascii.hexlify(sha256).decode(),
+            "chunk_size": args.chunk_size,
+            "chunks": manifests[path]
+        }
+
+        with open(base + ".manifest.json", "w") as f:
+            json.dump(manifest, f, indent=4, sort_keys=True)
+
+        print("{}: {} bytes, {} chunks, SHA256 {}".format(
+            name, size, len(manifest["chunks"]), manifest["sha256"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="+",
+                        help="application binaries")
+    parser.add_argument("-o", "--output", default=".",
+                        help="output directory")
+    parser.add_argument("-v", "--version", type=int, default=0,
+                        help="firmware version, usually a timestamp")
+    parser.add_argument("-c", "--campaign", default=None,
+                        help="campaign GUID")
+    parser.add_argument("--chunk-size", type=int,
+                        default=IMAGE_RECORD_CHECKPOINT_INTERVAL,
+                        help="manifest chunk size in bytes")
+    parser.add_argument("-j", "--jobs", type=int,
+                        default=multiprocessing.cpu_count(),
+                        help="number of worker processes")
+    args = parser.parse_args()
+
+    if args.chunk_size <= 0:
+        parser.error("chunk size must be positive")
+
+    # outputs are named after the input, without its directory
+    names = [output_name(path) for path in args.input]
+    duplicates = sorted(set(name for name in names if names.count(name) > 1))
+    if duplicates:
+        parser.error("inputs with the same name would overwrite each other: " +
+                     ", ".join(duplicates))
+
+    package(args)
+
+
+if __name__ == "__main__":
+    main()
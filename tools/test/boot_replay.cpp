@@ -0,0 +1,209 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+/*
+ * Host build of the bootloader decision, for replaying device dumps.
+ *
+ *   boot_replay --config             print the layout as an mbed_app.json
+ *   boot_replay FLASH [SD] [-o OUT]  run upgradeApplicationFromStorage()
+ *
+ * FLASH is the internal flash dump from MBED_CONF_APP_FLASH_START_ADDRESS,
+ * SD the storage dump. The layout is fixed when compiling, see the
+ * Makefile. With -o the internal flash is written back after the run.
+ * The energy counters of the run are printed to stderr as JSON.
+ */
+
+#include "upgrade.h"
+#include "active_application.h"
+#include "bootloader_common.h"
+
+#include "update-client-paal/arm_uc_paal_update.h"
+#include "mbed.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define STR(x)  #x
+#define XSTR(x) STR(x)
+
+#define SLOT_SIZE (MBED_CONF_UPDATE_CLIENT_STORAGE_SIZE / \
+                   MBED_CONF_UPDATE_CLIENT_STORAGE_LOCATIONS)
+
+static const char* const config[] = {
+    "MBED_CONF_APP_FLASH_START_ADDRESS=" XSTR(MBED_CONF_APP_FLASH_START_ADDRESS),
+    "MBED_CONF_UPDATE_CLIENT_APPLICATION_DETAILS=" XSTR(MBED_CONF_UPDATE_CLIENT_APPLICATION_DETAILS),
+    "MBED_CONF_APP_APPLICATION_START_ADDRESS=" XSTR(MBED_CONF_APP_APPLICATION_START_ADDRESS),
+    "MBED_CONF_APP_MAX_APPLICATION_SIZE=" XSTR(MBED_CONF_APP_MAX_APPLICATION_SIZE),
+    "MBED_CONF_UPDATE_CLIENT_STORAGE_ADDRESS=" XSTR(MBED_CONF_UPDATE_CLIENT_STORAGE_ADDRESS),
+    "MBED_CONF_UPDATE_CLIENT_STORAGE_SIZE=" XSTR(MBED_CONF_UPDATE_CLIENT_STORAGE_SIZE),
+    "MBED_CONF_UPDATE_CLIENT_STORAGE_LOCATIONS=" XSTR(MBED_CONF_UPDATE_CLIENT_STORAGE_LOCATIONS),
+    "MBED_CONF_APP_FLASH_PAGE_SIZE=" XSTR(MBED_CONF_APP_FLASH_PAGE_SIZE),
+    "MBED_CONF_APP_FLASH_SECTOR_SIZE=" XSTR(MBED_CONF_APP_FLASH_SECTOR_SIZE),
+    "BUFFER_SIZE=" XSTR(BUFFER_SIZE),
+    "SHOW_PROGRESS_BAR=" XSTR(SHOW_PROGRESS_BAR),
+    "ENERGY_ACCOUNTING=" XSTR(ENERGY_ACCOUNTING),
+    "MBED_CONF_APP_ENERGY_STORAGE_READ=" XSTR(ENERGY_COST_STORAGE_READ),
+    "MBED_CONF_APP_ENERGY_STORAGE_READ_CALL=" XSTR(ENERGY_COST_STORAGE_READ_CALL),
+    "MBED_CONF_APP_ENERGY_FLASH_PROGRAM=" XSTR(ENERGY_COST_FLASH_PROGRAM),
+    "MBED_CONF_APP_ENERGY_FLASH_PROGRAM_CALL=" XSTR(ENERGY_COST_FLASH_PROGRAM_CALL),
+    "MBED_CONF_APP_ENERGY_FLASH_ERASE=" XSTR(ENERGY_COST_FLASH_ERASE),
+    "MBED_CONF_APP_ENERGY_SHA256=" XSTR(ENERGY_COST_SHA256),
+    "MBED_CONF_APP_ENERGY_BLAKE2S=" XSTR(ENERGY_COST_BLAKE2S),
+    "MBED_CONF_APP_ENERGY_UART=" XSTR(ENERGY_COST_UART)
+};
+
+static bool load(const char* path, std::vector<uint8_t>& data, size_t size)
+{
+    FILE* file = fopen(path, "rb");
+
+    if (!file)
+    {
+        perror(path);
+        return false;
+    }
+
+    std::vector<uint8_t> contents;
+    uint8_t chunk[4096];
+    size_t length;
+
+    while ((length = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        contents.insert(contents.end(), chunk, chunk + length);
+    }
+
+    fclose(file);
+
+    /* missing bytes read as erased */
+    if (contents.size() < size)
+    {
+        contents.resize(size, 0xFF);
+    }
+
+    data.swap(contents);
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if ((argc == 2) && (strcmp(argv[1], "--config") == 0))
+    {
+        printf("{\n    \"macros\": [\n");
+
+        for (size_t index = 0; index < sizeof(config) / sizeof(config[0]); index++)
+        {
+            printf("        \"%s\"%s\n", config[index],
+                   (index + 1 < sizeof(config) / sizeof(config[0])) ? "," : "");
+        }
+
+        printf("    ]\n}\n");
+
+        return 0;
+    }
+
+    const char* flashPath = NULL;
+    const char* sdPath = NULL;
+    const char* outputPath = NULL;
+
+    for (int index = 1; index < argc; index++)
+    {
+        if ((strcmp(argv[index], "-o") == 0) && (index + 1 < argc))
+        {
+            outputPath = argv[++index];
+        }
+        else if (!flashPath)
+        {
+            flashPath = argv[index];
+        }
+        else if (!sdPath)
+        {
+            sdPath = argv[index];
+        }
+    }
+
+    if (!flashPath)
+    {
+        fprintf(stderr, "usage: %s --config | FLASH [SD] [-o OUT]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> flash;
+    std::vector<uint8_t> sd;
+
+    if (!load(flashPath, flash, REPLAY_FLASH_SIZE) ||
+        (sdPath && !load(sdPath, sd, 0)) ||
+        (flash.size() != REPLAY_FLASH_SIZE))
+    {
+        fprintf(stderr, "%s: cannot load dumps\n", argv[0]);
+        return 2;
+    }
+
+    /* slots beyond the end of the dump are empty */
+    sd.resize(MBED_CONF_UPDATE_CLIENT_STORAGE_ADDRESS +
+              MBED_CONF_UPDATE_CLIENT_STORAGE_SIZE, 0xFF);
+
+    stub_flash_set(&flash[0], MBED_CONF_APP_FLASH_START_ADDRESS,
+                   REPLAY_FLASH_SIZE, MBED_CONF_APP_FLASH_PAGE_SIZE,
+                   MBED_CONF_APP_FLASH_SECTOR_SIZE);
+    stub_paal_set_active(&flash[FIRMWARE_METADATA_HEADER_ADDRESS -
+                                MBED_CONF_APP_FLASH_START_ADDRESS]);
+    stub_paal_set_storage(&sd[MBED_CONF_UPDATE_CLIENT_STORAGE_ADDRESS],
+                          MBED_CONF_UPDATE_CLIENT_STORAGE_SIZE,
+                          SLOT_SIZE, REPLAY_SLOT_HEADER_SIZE);
+    ARM_UCP_Initialize(arm_ucp_event_handler);
+
+    if (!activeStorageInit())
+    {
+        return 2;
+    }
+
+    /* the boot counter lives in RAM, a dump always replays a fresh boot */
+    bool canForward = upgradeApplicationFromStorage();
+
+    activeStorageDeinit();
+
+#if ENERGY_ACCOUNTING == 1
+    /* operation counts of the run, for the energy replay of inspect_dumps.py */
+    fprintf(stderr,
+            "{\"storage_read\": %" PRIu32 ", \"storage_read_call\": %" PRIu32 ", "
+            "\"flash_program\": %" PRIu32 ", \"flash_program_call\": %" PRIu32 ", "
+            "\"flash_erase\": %" PRIu32 ", \"sha256\": %" PRIu32 ", "
+            "\"blake2s\": %" PRIu32 ", \"uart\": %" PRIu32 "}\n",
+            energyCounters.storageRead, energyCounters.storageReadCalls,
+            energyCounters.flashProgram, energyCounters.flashProgramCalls,
+            energyCounters.flashErase, energyCounters.sha256,
+            energyCounters.blake2s, energyCounters.uart);
+#endif
+
+    if (outputPath)
+    {
+        FILE* file = fopen(outputPath, "wb");
+
+        if (!file || (fwrite(&flash[0], 1, flash.size(), file) != flash.size()))
+        {
+            perror(outputPath);
+            return 2;
+        }
+
+        fclose(file);
+    }
+
+    return canForward ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+/*
+ * Host test driver for SerialCoprocessorTransport.
+ *
+ *   coprocessor_test DEVICE              query the version
+ *   coprocessor_test DEVICE IMAGE [-c]   forward IMAGE, -c corrupts its hash
+ *
+ * DEVICE is a tty with a loader on the other end, e.g., the pty created by
+ * tools/coprocessor_loader.py --pty.
+ */
+
+#include "coprocessor.h"
+
+#include "update-client-paal/arm_uc_paal_update.h"
+#include "mbedtls/sha256.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define SLOT_HEADER_SIZE 512
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s DEVICE [IMAGE [-c]]\n", argv[0]);
+        return 2;
+    }
+
+    stub_serial_device = argv[1];
+    SerialCoprocessorTransport transport(NC, NC);
+
+    uint64_t version = 0;
+
+    if (transport.getVersion(&version))
+    {
+        printf("version: %llu\n", (unsigned long long) version);
+    }
+    else
+    {
+        printf("version: unknown\n");
+    }
+
+    if (argc < 3)
+    {
+        return 0;
+    }
+
+    FILE* file = fopen(argv[2], "rb");
+
+    if (!file)
+    {
+        perror(argv[2]);
+        return 2;
+    }
+
+    /* single slot storage: header, then the image */
+    std::vector<uint8_t> storage(SLOT_HEADER_SIZE, 0);
+    uint8_t chunk[4096];
+    size_t length;
+
+    while ((length = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        storage.insert(storage.end(), chunk, chunk + length);
+    }
+
+    fclose(file);
+
+    uint64_t size = storage.size() - SLOT_HEADER_SIZE;
+
+    for (uint32_t index = 0; index < 8; index++)
+    {
+        storage[8 + index] = version >> (56 - 8 * index);
+        storage[16 + index] = size >> (56 - 8 * index);
+    }
+
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, &storage[SLOT_HEADER_SIZE], size);
+    mbedtls_sha256_finish(&ctx, &storage[24]);
+
+    if ((argc > 3) && (strcmp(argv[3], "-c") == 0))
+    {
+        storage[24] ^= 0xFF;
+    }
+
+    stub_paal_set_storage(&storage[0], storage.size(), storage.size(),
+                          SLOT_HEADER_SIZE);
+    ARM_UCP_Initialize(arm_ucp_event_handler);
+
+    arm_uc_firmware_details_t details;
+    ARM_UCP_GetFirmwareDetails(0, &details);
+
+    bool result = forwardCoprocessorFirmware(0, &details, &transport);
+
+    printf("forward: %s\n", result ? "committed" : "failed");
+
+    return result ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+/*
+ * Host test for the erase counters on a RAM flash image, built with the
+ * layout in erase_counter_test_config.h.
+ */
+
+#include "erase_counter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+uint32_t eraseCounterTestAddress = 0x38000;
+
+static int failures = 0;
+
+#define CHECK(condition) do {                                       \
+    if (!(condition)) {                                             \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__,     \
+               #condition);                                         \
+        failures++;                                                 \
+    }                                                               \
+} while (0)
+
+#define SLOT_SIZE (MBED_CONF_UPDATE_CLIENT_STORAGE_SIZE / \
+                   MBED_CONF_UPDATE_CLIENT_STORAGE_LOCATIONS)
+
+static std::vector<uint8_t> image(ERASE_COUNTER_TEST_FLASH_SIZE);
+static FlashIAP flash;
+
+/* location each call of the fake PAAL was made with */
+static uint32_t prepared = 0xFFFFFFFF;
+static uint32_t read = 0xFFFFFFFF;
+
+/* reject the next calls to Prepare */
+static bool prepareFails = false;
+
+static arm_uc_error_t fakePrepare(uint32_t location,
+                                  const arm_uc_firmware_details_t*,
+                                  arm_uc_buffer_t*)
+{
+    arm_uc_error_t result = { prepareFails ? ERR_INVALID_PARAMETER : ERR_NONE };
+    prepared = location;
+    return result;
+}
+
+static arm_uc_error_t fakeRead(uint32_t location, uint32_t,
+                               arm_uc_buffer_t*)
+{
+    arm_uc_error_t result = { ERR_NONE };
+    read = location;
+    return result;
+}
+
+static ARM_UC_PAAL_UPDATE fakePAAL;
+
+/**
+ * Erase the whole flash image and load the counters at address.
+ */
+static bool initErased(uint32_t address)
+{
+    memset(&image[0], 0xFF, image.size());
+    stub_flash_set(&image[0], 0, image.size(),
+                   ERASE_COUNTER_TEST_PAGE_SIZE, ERASE_COUNTER_TEST_SECTOR_SIZE);
+
+    eraseCounterTestAddress = address;
+
+    return eraseCounterInit(&flash);
+}
+
+static uint32_t getSlotWear(uint32_t slot)
+{
+    uint32_t wear = 0xFFFFFFFF;
+    CHECK(eraseCounterGetSlotWear(slot, &wear));
+    return wear;
+}
+
+static void testOverlap()
+{
+    /* bootloader, SOTP sections, application details, active application
+       and candidate storage */
+    CHECK(!initErased(0x2000));
+    CHECK(!initErased(0x8000));
+    CHECK(!initErased(0x9000));
+    CHECK(!initErased(0xA000));
+    CHECK(!initErased(0x10000));
+    CHECK(!initErased(0x2A000));
+
+    /* nothing is counted and the wrapper passes calls through */
+    uint32_t count = 0;
+    CHECK(!eraseCounterGet(0xA000, &count));
+
+    const ARM_UC_PAAL_UPDATE* paal = eraseCounterWrapPAAL(&fakePAAL);
+    CHECK(paal->Prepare(1, NULL, NULL).error == ERR_NONE);
+    CHECK(prepared == 1);
+
+    CHECK(initErased(0x38000));
+}
+
+static void testPersistence()
+{
+    uint32_t count = 0xFFFFFFFF;
+
+    CHECK(initErased(0x38000));
+    CHECK(eraseCounterGet(0xA000, &count) && (count == 0));
+    CHECK(!eraseCounterGet(0x9000, &count));
+
+    CHECK(eraseCounterRecord(0xA000));
+    CHECK(eraseCounterRecord(0x2C100));
+    CHECK(eraseCounterRecord(0x2C200));
+
+    /* counts are replayed from flash */
+    CHECK(eraseCounterInit(&flash));
+    CHECK(eraseCounterGet(0xA000, &count) && (count == 1));
+    CHECK(eraseCounterGet(0x2C000, &count) && (count == 2));
+    CHECK(getSlotWear(0) == 0);
+    CHECK(getSlotWear(1) == 2);
+}
+
+static void testWrapper()
+{
+    uint32_t slot = 0xFFFFFFFF;
+
+    CHECK(initErased(0x38000));
+    const ARM_UC_PAAL_UPDATE* paal = eraseCounterWrapPAAL(&fakePAAL);
+
+    /* prepare counts every sector of the requested slot */
+    CHECK(paal->Prepare(0, NULL, NULL).error == ERR_NONE);
+    CHECK(prepared == 0);
+    CHECK(getSlotWear(0) == 1);
+    CHECK(getSlotWear(1) == 0);
+
+    uint32_t count = 0;
+    CHECK(eraseCounterGet(MBED_CONF_UPDATE_CLIENT_STORAGE_ADDRESS + SLOT_SIZE - 1,
+                          &count) && (count == 1));
+
+    /* the application places the next candidate in the unworn slot */
+    CHECK(eraseCounterGetLeastWornSlot(&slot) && (slot == 1));
+    CHECK(paal->Prepare(slot, NULL, NULL).error == ERR_NONE);
+    CHECK(prepared == 1);
+    CHECK(getSlotWear(0) == 1);
+    CHECK(getSlotWear(1) == 1);
+
+    /* a rejected prepare erases nothing */
+    prepareFails = true;
+    CHECK(paal->Prepare(0, NULL, NULL).error != ERR_NONE);
+    prepareFails = false;
+    CHECK(getSlotWear(0) == 1);
+
+    /* other calls go to the requested location */
+    CHECK(paal->Read(0, 0, NULL).error == ERR_NONE);
+    CHECK(read == 0);
+    CHECK(paal->Read(1, 0, NULL).error == ERR_NONE);
+    CHECK(read == 1);
+
+    /* counts survive a reset */
+    CHECK(eraseCounterInit(&flash));
+    CHECK(getSlotWear(0) == 1);
+    CHECK(getSlotWear(1) == 1);
+}
+
+int main()
+{
+    fakePAAL.Prepare = fakePrepare;
+    fakePAAL.Read = fakeRead;
+
+    testOverlap();
+    testPersistence();
+    testWrapper();
+
+    printf("erase_counter_test: %s\n", failures ? "FAIL" : "OK");
+
+    return failures ? 1 : 0;
+}
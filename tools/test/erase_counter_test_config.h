@@ -0,0 +1,58 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+/*
+ * Layout erase_counter_test builds source/erase_counter.cpp with, included
+ * before every other header. The counter region is a variable, so the test
+ * can move it onto each region it must not overlap.
+ *
+ *   0x00000  bootloader
+ *   0x08000  SOTP sections, 4 KiB each
+ *   0x0A000  application details
+ *   0x0A400  active application
+ *   0x20000  candidate storage, two slots of 48 KiB
+ *   0x38000  erase counters, two banks of one sector
+ */
+
+#ifndef ERASE_COUNTER_TEST_CONFIG_H
+#define ERASE_COUNTER_TEST_CONFIG_H
+
+#include <stdint.h>
+
+extern uint32_t eraseCounterTestAddress;
+
+#define MBED_CONF_APP_ERASE_COUNTER_ADDRESS        eraseCounterTestAddress
+#define MBED_CONF_APP_ERASE_COUNTER_SIZE           0x2000
+
+#define MBED_CONF_UPDATE_CLIENT_APPLICATION_DETAILS 0xA000
+#define MBED_CONF_APP_APPLICATION_START_ADDRESS    0xA400
+#define MBED_CONF_APP_MAX_APPLICATION_SIZE         0x15C00
+#define MBED_CONF_UPDATE_CLIENT_STORAGE_ADDRESS    0x20000
+#define MBED_CONF_UPDATE_CLIENT_STORAGE_SIZE       0x18000
+#define MBED_CONF_UPDATE_CLIENT_STORAGE_LOCATIONS  2
+
+#define PAL_INTERNAL_FLASH_SECTION_1_ADDRESS       0x8000
+#define PAL_INTERNAL_FLASH_SECTION_1_SIZE          0x1000
+#define PAL_INTERNAL_FLASH_SECTION_2_ADDRESS       0x9000
+#define PAL_INTERNAL_FLASH_SECTION_2_SIZE          0x1000
+
+#define ERASE_COUNTER_TEST_FLASH_SIZE              0x40000
+#define ERASE_COUNTER_TEST_PAGE_SIZE               8
+#define ERASE_COUNTER_TEST_SECTOR_SIZE             0x1000
+
+#endif // ERASE_COUNTER_TEST_CONFIG_H
@@ -0,0 +1,504 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+/*
+ * Host test for NANDBlockMap on a simulated NAND die with injected factory
+ * bad blocks and program/erase failures.
+ */
+
+#include "NANDBlockMap.h"
+#include "bootloader_common.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <set>
+#include <vector>
+
+#define PAGE_SIZE       512
+#define SPARE_SIZE      16
+#define PAGES_PER_BLOCK 8
+#define BLOCK_COUNT     128
+
+static int failures = 0;
+
+#define CHECK(condition) do {                                       \
+    if (!(condition)) {                                             \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__,     \
+               #condition);                                         \
+        failures++;                                                 \
+    }                                                               \
+} while (0)
+
+/**
+ * RAM backed NAND die following the rules the driver relies on.
+ * @detail Factory bad blocks have a zero marker and garbage that fails
+ *         ECC. Blocks set to wear out fail every program and erase.
+ *         Programming a page twice, out of order, or erasing a factory bad
+ *         block is counted as a violation.
+ */
+class SimulatedNAND : public NANDArray
+{
+public:
+    SimulatedNAND()
+        : markerReads(0),
+          violations(0),
+          _data(BLOCK_COUNT * PAGES_PER_BLOCK * (PAGE_SIZE + SPARE_SIZE), 0xFF),
+          _programmed(BLOCK_COUNT * PAGES_PER_BLOCK, false),
+          _eccFail(BLOCK_COUNT * PAGES_PER_BLOCK, false)
+    {
+    }
+
+    void setFactoryBad(uint32_t block)
+    {
+        _factoryBad.insert(block);
+        page(block * PAGES_PER_BLOCK)[PAGE_SIZE] = 0x00;
+        _eccFail[block * PAGES_PER_BLOCK] = true;
+    }
+
+    void setWorn(uint32_t block)
+    {
+        _worn.insert(block);
+    }
+
+    bool isMarkedBad(uint32_t block)
+    {
+        return page(block * PAGES_PER_BLOCK)[PAGE_SIZE] != 0xFF;
+    }
+
+    virtual int readPage(uint32_t row, uint32_t column,
+                         uint8_t* buffer, uint32_t length)
+    {
+        if (_eccFail[row])
+        {
+            return NAND_ERROR;
+        }
+
+        memcpy(buffer, page(row) + column, length);
+
+        return NAND_SUCCESS;
+    }
+
+    virtual int programPage(uint32_t row, const uint8_t* buffer,
+                            uint32_t length)
+    {
+        int result = checkProgram(row);
+
+        if (result == NAND_SUCCESS)
+        {
+            memcpy(page(row), buffer, length);
+            _programmed[row] = true;
+        }
+
+        return result;
+    }
+
+    virtual int copyPage(uint32_t sourceRow, uint32_t destinationRow)
+    {
+        if (_eccFail[sourceRow])
+        {
+            return NAND_ERROR;
+        }
+
+        int result = checkProgram(destinationRow);
+
+        if (result == NAND_SUCCESS)
+        {
+            memcpy(page(destinationRow), page(sourceRow), PAGE_SIZE);
+            _programmed[destinationRow] = true;
+        }
+
+        return result;
+    }
+
+    virtual int eraseBlock(uint32_t block)
+    {
+        if (_factoryBad.count(block))
+        {
+            violations++;
+        }
+
+        if (_worn.count(block))
+        {
+            return NAND_ERROR_WORN;
+        }
+
+        for (uint32_t index = 0; index < PAGES_PER_BLOCK; index++)
+        {
+            uint32_t row = block * PAGES_PER_BLOCK + index;
+
+            memset(page(row), 0xFF, PAGE_SIZE + SPARE_SIZE);
+            _programmed[row] = false;
+            _eccFail[row] = false;
+        }
+
+        return NAND_SUCCESS;
+    }
+
+    virtual int readBadBlockMarker(uint32_t block, bool* bad)
+    {
+        markerReads++;
+
+        *bad = isMarkedBad(block);
+
+        return NAND_SUCCESS;
+    }
+
+    virtual int writeBadBlockMarker(uint32_t block)
+    {
+        page(block * PAGES_PER_BLOCK)[PAGE_SIZE] = 0x00;
+
+        return NAND_SUCCESS;
+    }
+
+    uint8_t* page(uint32_t row)
+    {
+        return &_data[row * (PAGE_SIZE + SPARE_SIZE)];
+    }
+
+    uint32_t markerReads;
+    uint32_t violations;
+
+private:
+    int checkProgram(uint32_t row)
+    {
+        uint32_t block = row / PAGES_PER_BLOCK;
+
+        /* pages are programmed once and in order within a block */
+        for (uint32_t later = row; later < (block + 1) * PAGES_PER_BLOCK; later++)
+        {
+            if (_programmed[later])
+            {
+                violations++;
+                return NAND_ERROR;
+            }
+        }
+
+        return _worn.count(block) ? NAND_ERROR_WORN : NAND_SUCCESS;
+    }
+
+    std::vector<uint8_t> _data;
+    std::vector<bool> _programmed;
+    std::vector<bool> _eccFail;
+    std::set<uint32_t> _factoryBad;
+    std::set<uint32_t> _worn;
+};
+
+static void fillPage(uint8_t* buffer, uint32_t seed)
+{
+    for (uint32_t index = 0; index < PAGE_SIZE; index++)
+    {
+        buffer[index] = (uint8_t) (index * 7 + seed * 13);
+    }
+}
+
+/* every logical block maps to a distinct good block outside the table */
+static void checkMapping(SimulatedNAND& nand, NANDBlockMap& map)
+{
+    std::set<uint32_t> used;
+
+    for (uint32_t logical = 0; logical < map.getBlockCount(); logical++)
+    {
+        uint32_t physical = map.getPhysicalBlock(logical);
+
+        CHECK(physical < BLOCK_COUNT - NAND_TABLE_BLOCKS);
+        CHECK(!nand.isMarkedBad(physical));
+        CHECK(used.insert(physical).second);
+    }
+}
+
+static void testFactoryBadBlocks()
+{
+    SimulatedNAND nand;
+
+    /* block 0 also fails ECC, which must not stop the scan */
+    nand.setFactoryBad(0);
+    nand.setFactoryBad(5);
+    nand.setFactoryBad(6);
+    nand.setFactoryBad(100);
+
+    NANDBlockMap map(nand, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+
+    CHECK(map.init() == NAND_SUCCESS);
+    CHECK(nand.markerReads == BLOCK_COUNT);
+    CHECK(map.getBadBlockCount() == 4);
+    CHECK(map.getBlockCount() ==
+          BLOCK_COUNT - NAND_TABLE_BLOCKS - NAND_MAX_BAD_BLOCKS);
+    CHECK(map.getPhysicalBlock(0) == 1);
+    CHECK(map.getPhysicalBlock(3) == 4);
+    CHECK(map.getPhysicalBlock(4) == 7);
+    checkMapping(nand, map);
+
+    /* the table is loaded on the next boot, without scanning */
+    NANDBlockMap reboot(nand, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+
+    CHECK(reboot.init() == NAND_SUCCESS);
+    CHECK(nand.markerReads == BLOCK_COUNT);
+    CHECK(reboot.getBadBlockCount() == 4);
+
+    for (uint32_t logical = 0; logical < map.getBlockCount(); logical++)
+    {
+        CHECK(reboot.getPhysicalBlock(logical) == map.getPhysicalBlock(logical));
+    }
+
+    CHECK(nand.violations == 0);
+}
+
+static void testProgramFailure()
+{
+    SimulatedNAND nand;
+    nand.setFactoryBad(3);
+
+    NANDBlockMap map(nand, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+    CHECK(map.init() == NAND_SUCCESS);
+
+    const uint32_t logical = 10;
+    uint8_t buffer[PAGE_SIZE];
+
+    for (uint32_t page = 0; page < 3; page++)
+    {
+        fillPage(buffer, page);
+        CHECK(map.programPage(logical, page, buffer) == NAND_SUCCESS);
+    }
+
+    /* the block wears out on the fourth page */
+    uint32_t worn = map.getPhysicalBlock(logical);
+    nand.setWorn(worn);
+
+    fillPage(buffer, 3);
+    CHECK(map.programPage(logical, 3, buffer) == NAND_SUCCESS);
+
+    uint32_t spare = map.getPhysicalBlock(logical);
+    CHECK(spare != worn);
+    CHECK(nand.isMarkedBad(worn));
+    CHECK(map.getBadBlockCount() == 2);
+    checkMapping(nand, map);
+
+    /* pages written before the failure were moved along */
+    for (uint32_t page = 0; page < 4; page++)
+    {
+        fillPage(buffer, page);
+        CHECK(memcmp(nand.page(spare * PAGES_PER_BLOCK + page), buffer,
+                     PAGE_SIZE) == 0);
+    }
+
+    NANDBlockMap reboot(nand, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+    CHECK(reboot.init() == NAND_SUCCESS);
+    CHECK(reboot.getPhysicalBlock(logical) == spare);
+    CHECK(reboot.getBadBlockCount() == 2);
+    CHECK(nand.violations == 0);
+}
+
+static void testEraseFailure()
+{
+    SimulatedNAND nand;
+    NANDBlockMap map(nand, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+    CHECK(map.init() == NAND_SUCCESS);
+
+    const uint32_t logical = 20;
+    uint32_t worn = map.getPhysicalBlock(logical);
+    nand.setWorn(worn);
+
+    /* the first spare is worn as well and is skipped */
+    uint32_t firstSpare = map.getBlockCount();
+    nand.setWorn(firstSpare);
+
+    CHECK(map.eraseBlock(logical) == NAND_SUCCESS);
+    CHECK(map.getPhysicalBlock(logical) == firstSpare + 1);
+    CHECK(nand.isMarkedBad(worn));
+    CHECK(nand.isMarkedBad(firstSpare));
+    CHECK(map.getBadBlockCount() == 2);
+    checkMapping(nand, map);
+
+    /* a replaced block can wear out again */
+    nand.setWorn(firstSpare + 1);
+    CHECK(map.eraseBlock(logical) == NAND_SUCCESS);
+    CHECK(map.getPhysicalBlock(logical) == firstSpare + 2);
+    checkMapping(nand, map);
+
+    NANDBlockMap reboot(nand, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+    CHECK(reboot.init() == NAND_SUCCESS);
+    CHECK(reboot.getPhysicalBlock(logical) == firstSpare + 2);
+    CHECK(nand.violations == 0);
+}
+
+static void testSpareExhaustion()
+{
+    SimulatedNAND nand;
+
+    for (uint32_t block = 0; block < NAND_MAX_BAD_BLOCKS - 2; block++)
+    {
+        nand.setFactoryBad(2 * block + 1);
+    }
+
+    NANDBlockMap map(nand, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+    CHECK(map.init() == NAND_SUCCESS);
+    checkMapping(nand, map);
+
+    /* two spares left */
+    nand.setWorn(map.getPhysicalBlock(0));
+    CHECK(map.eraseBlock(0) == NAND_SUCCESS);
+    nand.setWorn(map.getPhysicalBlock(1));
+    CHECK(map.eraseBlock(1) == NAND_SUCCESS);
+    nand.setWorn(map.getPhysicalBlock(2));
+    CHECK(map.eraseBlock(2) == NAND_ERROR);
+    CHECK(map.getBadBlockCount() == NAND_MAX_BAD_BLOCKS);
+
+    /* one more factory bad block than the reserve */
+    SimulatedNAND full;
+
+    for (uint32_t block = 0; block <= NAND_MAX_BAD_BLOCKS; block++)
+    {
+        full.setFactoryBad(block);
+    }
+
+    NANDBlockMap fullMap(full, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+    CHECK(fullMap.init() == NAND_ERROR);
+}
+
+static void testTableBlocks()
+{
+    SimulatedNAND nand;
+
+    /* one table block is bad, the table lives in the other */
+    nand.setFactoryBad(BLOCK_COUNT - 1);
+
+    NANDBlockMap map(nand, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+    CHECK(map.init() == NAND_SUCCESS);
+    CHECK(map.getBadBlockCount() == 1);
+
+    nand.setWorn(map.getPhysicalBlock(7));
+    CHECK(map.eraseBlock(7) == NAND_SUCCESS);
+
+    uint32_t markerReads = nand.markerReads;
+    NANDBlockMap reboot(nand, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+    CHECK(reboot.init() == NAND_SUCCESS);
+    CHECK(nand.markerReads == markerReads);
+    CHECK(reboot.getPhysicalBlock(7) == map.getPhysicalBlock(7));
+    CHECK(nand.violations == 0);
+
+    /* with two table blocks, losing the newest copy keeps the older one */
+    SimulatedNAND twin;
+    NANDBlockMap first(twin, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+    CHECK(first.init() == NAND_SUCCESS);
+
+    uint32_t original = first.getPhysicalBlock(9);
+    twin.setWorn(original);
+    CHECK(first.eraseBlock(9) == NAND_SUCCESS);
+
+    /* initial table went to the first block, the update to the second */
+    twin.page((BLOCK_COUNT - 1) * PAGES_PER_BLOCK)[0] ^= 0x01;
+
+    NANDBlockMap second(twin, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+    CHECK(second.init() == NAND_SUCCESS);
+    CHECK(second.getPhysicalBlock(9) == original);
+}
+
+/**
+ * Change both stored tables and fix up their crc, as a table programmed by
+ * a faulty or older driver would look.
+ */
+static void rewriteTables(SimulatedNAND& nand,
+                          void (*change)(nand_block_table_t* table))
+{
+    for (uint32_t slot = 0; slot < NAND_TABLE_BLOCKS; slot++)
+    {
+        nand_block_table_t* table = (nand_block_table_t*)
+            nand.page((BLOCK_COUNT - NAND_TABLE_BLOCKS + slot) * PAGES_PER_BLOCK);
+
+        if (table->magic == NAND_TABLE_MAGIC)
+        {
+            change(table);
+            table->crc = crc32Update(0, (const uint8_t*) table,
+                                     offsetof(nand_block_table_t, crc));
+        }
+    }
+}
+
+static void remapOutsideSpares(nand_block_table_t* table)
+{
+    table->remapPhysical[0] = 3;
+}
+
+static void remapPastDie(nand_block_table_t* table)
+{
+    table->remapPhysical[0] = BLOCK_COUNT + 5;
+}
+
+static void unsortBadBlocks(nand_block_table_t* table)
+{
+    uint16_t first = table->badBlocks[0];
+    table->badBlocks[0] = table->badBlocks[1];
+    table->badBlocks[1] = first;
+}
+
+static void badBlockPastData(nand_block_table_t* table)
+{
+    table->badBlocks[1] = BLOCK_COUNT - 1;
+}
+
+static void testInconsistentTable()
+{
+    void (*changes[])(nand_block_table_t*) = {
+        remapOutsideSpares, remapPastDie, unsortBadBlocks, badBlockPastData
+    };
+
+    for (uint32_t change = 0; change < sizeof(changes) / sizeof(changes[0]); change++)
+    {
+        SimulatedNAND nand;
+        nand.setFactoryBad(4);
+        nand.setFactoryBad(30);
+
+        NANDBlockMap map(nand, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+        CHECK(map.init() == NAND_SUCCESS);
+
+        nand.setWorn(map.getPhysicalBlock(12));
+        CHECK(map.eraseBlock(12) == NAND_SUCCESS);
+
+        rewriteTables(nand, changes[change]);
+
+        /* a table with a matching crc but bad entries is not used */
+        uint32_t markerReads = nand.markerReads;
+        NANDBlockMap reboot(nand, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+
+        CHECK(reboot.init() == NAND_SUCCESS);
+        CHECK(nand.markerReads == markerReads + BLOCK_COUNT);
+        checkMapping(nand, reboot);
+
+        /* the rebuilt table supersedes the inconsistent one */
+        markerReads = nand.markerReads;
+        NANDBlockMap rebuilt(nand, PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+
+        CHECK(rebuilt.init() == NAND_SUCCESS);
+        CHECK(nand.markerReads == markerReads);
+        CHECK(nand.violations == 0);
+    }
+}
+
+int main()
+{
+    testFactoryBadBlocks();
+    testProgramFailure();
+    testEraseFailure();
+    testSpareExhaustion();
+    testTableBlocks();
+    testInconsistentTable();
+
+    printf("nand_block_map_test: %s\n", failures ? "FAIL" : "OK");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,411 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+/*
+ * Host test for SPINANDBlockDevice on a simulated SPI NAND chip behind the
+ * stub SPI bus, checking the commands sent for streaming reads.
+ */
+
+#include "SPINANDBlockDevice.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define PAGE_SIZE       512
+#define SPARE_SIZE      16
+#define PAGES_PER_BLOCK 4
+#define BLOCK_COUNT     64
+#define BLOCK_SIZE      (PAGE_SIZE * PAGES_PER_BLOCK)
+
+#define PIN_CS          4
+
+static int failures = 0;
+
+#define CHECK(condition) do {                                       \
+    if (!(condition)) {                                             \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__,     \
+               #condition);                                         \
+        failures++;                                                 \
+    }                                                               \
+} while (0)
+
+/* one command frame, with the row or column it addressed */
+typedef struct {
+    uint8_t opcode;
+    uint32_t address;
+    uint32_t length;    /* data bytes after the address */
+} command_t;
+
+/**
+ * SPI NAND chip with the 13h/31h/3Fh/03h cache read model of the driver.
+ * @detail 13h loads a page into the data register and the cache. 31h
+ *         moves the data register to the cache and loads the next page,
+ *         3Fh only moves the data register. Every frame except status
+ *         polls is logged.
+ */
+class SimulatedSPINAND : public StubSPIDevice
+{
+public:
+    SimulatedSPINAND()
+        : _array(BLOCK_COUNT * PAGES_PER_BLOCK * (PAGE_SIZE + SPARE_SIZE), 0xFF),
+          _dataRegister(PAGE_SIZE + SPARE_SIZE, 0xFF),
+          _cache(PAGE_SIZE + SPARE_SIZE, 0xFF),
+          _selected(false),
+          _row(0),
+          _writeEnabled(false),
+          _config(0)
+    {
+    }
+
+    void setFactoryBad(uint32_t block)
+    {
+        page(block * PAGES_PER_BLOCK)[PAGE_SIZE] = 0x00;
+    }
+
+    virtual void setPin(PinName pin, int value)
+    {
+        if (pin != PIN_CS)
+        {
+            return;
+        }
+
+        if ((value == 0) && !_selected)
+        {
+            _frame.clear();
+        }
+        else if ((value != 0) && _selected)
+        {
+            execute();
+        }
+
+        _selected = (value == 0);
+    }
+
+    virtual uint8_t transfer(uint8_t value)
+    {
+        uint8_t result = 0xFF;
+
+        if (!_selected)
+        {
+            return result;
+        }
+
+        _frame.push_back(value);
+
+        const uint32_t index = _frame.size() - 1;
+
+        switch (_frame[0])
+        {
+            case 0x0F:
+                /* status and configuration, never busy and no ECC errors */
+                if (index == 2)
+                {
+                    result = (_frame[1] == 0xB0) ? _config : 0x00;
+                }
+                break;
+
+            case 0x03:
+                /* column, one dummy byte, then data */
+                if (index >= 4)
+                {
+                    result = _cache[getColumn() + index - 4];
+                }
+                break;
+
+            case 0x02:
+                /* column, then data into a reset cache */
+                if (index == 2)
+                {
+                    _cache.assign(_cache.size(), 0xFF);
+                }
+                else if (index > 2)
+                {
+                    _cache[getColumn() + index - 3] = value;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        return result;
+    }
+
+    uint8_t* page(uint32_t row)
+    {
+        return &_array[row * (PAGE_SIZE + SPARE_SIZE)];
+    }
+
+    std::vector<command_t> log;
+
+private:
+    uint32_t getColumn() const
+    {
+        return (_frame[1] << 8) | _frame[2];
+    }
+
+    uint32_t getRow() const
+    {
+        return (_frame[1] << 16) | (_frame[2] << 8) | _frame[3];
+    }
+
+    void load(uint32_t row)
+    {
+        _row = row;
+        _dataRegister.assign(page(row), page(row) + PAGE_SIZE + SPARE_SIZE);
+    }
+
+    void execute()
+    {
+        if (_frame.empty() || (_frame[0] == 0x0F))
+        {
+            return;
+        }
+
+        command_t command = { _frame[0], 0, 0 };
+
+        switch (_frame[0])
+        {
+            case 0x13:
+                command.address = getRow();
+                load(command.address);
+                _cache = _dataRegister;
+                break;
+
+            case 0x31:
+                _cache = _dataRegister;
+                load(_row + 1);
+                break;
+
+            case 0x3F:
+                _cache = _dataRegister;
+                break;
+
+            case 0x03:
+                command.address = getColumn();
+                command.length = _frame.size() - 4;
+                break;
+
+            case 0x02:
+                command.address = getColumn();
+                command.length = _frame.size() - 3;
+                break;
+
+            case 0x06:
+                _writeEnabled = true;
+                break;
+
+            case 0x10:
+                command.address = getRow();
+
+                if (_writeEnabled)
+                {
+                    for (uint32_t index = 0; index < _cache.size(); index++)
+                    {
+                        page(command.address)[index] &= _cache[index];
+                    }
+                }
+
+                _writeEnabled = false;
+                break;
+
+            case 0xD8:
+                command.address = getRow();
+
+                if (_writeEnabled)
+                {
+                    memset(page(command.address), 0xFF,
+                           PAGES_PER_BLOCK * (PAGE_SIZE + SPARE_SIZE));
+                }
+
+                _writeEnabled = false;
+                break;
+
+            case 0x1F:
+                if (_frame[1] == 0xB0)
+                {
+                    _config = _frame[2];
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        log.push_back(command);
+    }
+
+    std::vector<uint8_t> _array;
+    std::vector<uint8_t> _dataRegister;
+    std::vector<uint8_t> _cache;
+    std::vector<uint8_t> _frame;
+    bool _selected;
+    uint32_t _row;
+    bool _writeEnabled;
+    uint8_t _config;
+};
+
+static SimulatedSPINAND chip;
+
+static void fill(std::vector<uint8_t>& buffer, uint32_t seed)
+{
+    for (uint32_t index = 0; index < buffer.size(); index++)
+    {
+        buffer[index] = (uint8_t) (index * 7 + seed * 13 + index / PAGE_SIZE);
+    }
+}
+
+/* log entries from first on with the given opcodes */
+static std::vector<command_t> getCommands(size_t first, const char* opcodes)
+{
+    std::vector<command_t> result;
+
+    for (size_t index = first; index < chip.log.size(); index++)
+    {
+        if (strchr(opcodes, chip.log[index].opcode))
+        {
+            result.push_back(chip.log[index]);
+        }
+    }
+
+    return result;
+}
+
+static bool isCommand(const command_t& command, uint8_t opcode,
+                      uint32_t address, uint32_t length)
+{
+    return (command.opcode == opcode) &&
+           (command.address == address) &&
+           (command.length == length);
+}
+
+static void testStreamingRead(SPINANDBlockDevice& nand)
+{
+    /* logical blocks 0 to 2 hold a known pattern */
+    std::vector<uint8_t> written(3 * BLOCK_SIZE);
+    fill(written, 1);
+
+    CHECK(nand.erase(0, written.size()) == BD_ERROR_OK);
+    CHECK(nand.program(&written[0], 0, written.size()) == BD_ERROR_OK);
+
+    /* from column 100 of the last page of block 0 to column 50 of the
+       third page of block 1, which is physical block 2 */
+    const uint32_t address = 3 * PAGE_SIZE + 100;
+    const uint32_t size = (PAGE_SIZE - 100) + 2 * PAGE_SIZE + 50;
+    std::vector<uint8_t> buffer(size);
+
+    size_t first = chip.log.size();
+    CHECK(nand.read(&buffer[0], address, size) == BD_ERROR_OK);
+    CHECK(memcmp(&buffer[0], &written[address], size) == 0);
+
+    const char opcodes[] = { 0x13, 0x31, 0x3F, 0x03, 0x00 };
+    std::vector<command_t> commands = getCommands(first, opcodes);
+
+    /* a single page in block 0 needs no cache read, the run in block 1
+       restarts with a page read at the remapped row */
+    CHECK(commands.size() == 9);
+
+    if (commands.size() == 9)
+    {
+        CHECK(isCommand(commands[0], 0x13, 3, 0));
+        CHECK(isCommand(commands[1], 0x03, 100, PAGE_SIZE - 100));
+        CHECK(isCommand(commands[2], 0x13, 2 * PAGES_PER_BLOCK, 0));
+        CHECK(isCommand(commands[3], 0x31, 0, 0));
+        CHECK(isCommand(commands[4], 0x03, 0, PAGE_SIZE));
+        CHECK(isCommand(commands[5], 0x31, 0, 0));
+        CHECK(isCommand(commands[6], 0x03, 0, PAGE_SIZE));
+        CHECK(isCommand(commands[7], 0x3F, 0, 0));
+        CHECK(isCommand(commands[8], 0x03, 0, 50));
+    }
+
+    /* a whole block followed by the first page of the next one */
+    buffer.resize(BLOCK_SIZE + PAGE_SIZE);
+
+    first = chip.log.size();
+    CHECK(nand.read(&buffer[0], BLOCK_SIZE, buffer.size()) == BD_ERROR_OK);
+    CHECK(memcmp(&buffer[0], &written[BLOCK_SIZE], buffer.size()) == 0);
+
+    commands = getCommands(first, opcodes);
+
+    CHECK(commands.size() == 1 + 2 * PAGES_PER_BLOCK + 2);
+
+    if (commands.size() == 1 + 2 * PAGES_PER_BLOCK + 2)
+    {
+        CHECK(isCommand(commands[0], 0x13, 2 * PAGES_PER_BLOCK, 0));
+
+        for (uint32_t page = 0; page < PAGES_PER_BLOCK; page++)
+        {
+            uint8_t opcode = ((page + 1) < PAGES_PER_BLOCK) ? 0x31 : 0x3F;
+
+            CHECK(isCommand(commands[1 + 2 * page], opcode, 0, 0));
+            CHECK(isCommand(commands[2 + 2 * page], 0x03, 0, PAGE_SIZE));
+        }
+
+        CHECK(isCommand(commands[9], 0x13, 3 * PAGES_PER_BLOCK, 0));
+        CHECK(isCommand(commands[10], 0x03, 0, PAGE_SIZE));
+    }
+}
+
+static void testProgramCommands(SPINANDBlockDevice& nand)
+{
+    std::vector<uint8_t> buffer(PAGE_SIZE);
+    fill(buffer, 2);
+
+    /* logical block 3 is physical block 4, its second page is row 17 */
+    size_t first = chip.log.size();
+    CHECK(nand.program(&buffer[0], 3 * BLOCK_SIZE + PAGE_SIZE,
+                       PAGE_SIZE) == BD_ERROR_OK);
+
+    const char opcodes[] = { 0x06, 0x02, 0x10, 0x00 };
+    std::vector<command_t> commands = getCommands(first, opcodes);
+
+    CHECK(commands.size() == 3);
+
+    if (commands.size() == 3)
+    {
+        CHECK(isCommand(commands[0], 0x06, 0, 0));
+        CHECK(isCommand(commands[1], 0x02, 0, PAGE_SIZE));
+        CHECK(isCommand(commands[2], 0x10, 4 * PAGES_PER_BLOCK + 1, 0));
+    }
+
+    CHECK(memcmp(chip.page(4 * PAGES_PER_BLOCK + 1), &buffer[0], PAGE_SIZE) == 0);
+}
+
+int main()
+{
+    stub_spi_device = &chip;
+
+    /* logical block 1 skips the factory bad block */
+    chip.setFactoryBad(1);
+
+    SPINANDBlockDevice nand(0, 1, 2, PIN_CS,
+                            PAGE_SIZE, PAGES_PER_BLOCK, BLOCK_COUNT);
+
+    CHECK(nand.init() == BD_ERROR_OK);
+    CHECK(nand.get_bad_block_count() == 1);
+    CHECK(nand.size() == (bd_size_t) (BLOCK_COUNT - NAND_TABLE_BLOCKS -
+                                      NAND_MAX_BAD_BLOCKS) * BLOCK_SIZE);
+
+    testStreamingRead(nand);
+    testProgramCommands(nand);
+
+    printf("spi_nand_test: %s\n", failures ? "FAIL" : "OK");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,341 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#include "mbed.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+const char* stub_serial_device = 0;
+StubSPIDevice* stub_spi_device = 0;
+
+static uint8_t* stubFlash = 0;
+static uint32_t stubFlashStart = 0;
+static uint32_t stubFlashSize = 0;
+static uint32_t stubPageSize = 0;
+static uint32_t stubSectorSize = 0;
+
+void stub_flash_set(uint8_t* data, uint32_t start, uint32_t size,
+                    uint32_t pageSize, uint32_t sectorSize)
+{
+    stubFlash = data;
+    stubFlashStart = start;
+    stubFlashSize = size;
+    stubPageSize = pageSize;
+    stubSectorSize = sectorSize;
+}
+
+/* true if [address, address + size) lies in flash and is aligned to unit */
+static bool isValidRange(uint32_t address, uint32_t size, uint32_t unit)
+{
+    return stubFlash &&
+           (address >= stubFlashStart) &&
+           ((uint64_t) address + size <= (uint64_t) stubFlashStart + stubFlashSize) &&
+           ((address - stubFlashStart) % unit == 0) &&
+           (size % unit == 0);
+}
+
+int FlashIAP::init()
+{
+    return stubFlash ? 0 : -1;
+}
+
+int FlashIAP::deinit()
+{
+    return 0;
+}
+
+int FlashIAP::read(void* buffer, uint32_t address, uint32_t size)
+{
+    if (!isValidRange(address, size, 1))
+    {
+        return -1;
+    }
+
+    memcpy(buffer, &stubFlash[address - stubFlashStart], size);
+
+    return 0;
+}
+
+int FlashIAP::program(const void* buffer, uint32_t address, uint32_t size)
+{
+    if (!isValidRange(address, size, stubPageSize))
+    {
+        return -1;
+    }
+
+    const uint8_t* data = static_cast<const uint8_t*>(buffer);
+    uint8_t* target = &stubFlash[address - stubFlashStart];
+
+    for (uint32_t index = 0; index < size; index++)
+    {
+        if ((target[index] & data[index]) != data[index])
+        {
+            return -1;
+        }
+    }
+
+    for (uint32_t index = 0; index < size; index++)
+    {
+        target[index] &= data[index];
+    }
+
+    return 0;
+}
+
+int FlashIAP::erase(uint32_t address, uint32_t size)
+{
+    if (!isValidRange(address, size, stubSectorSize))
+    {
+        return -1;
+    }
+
+    memset(&stubFlash[address - stubFlashStart], 0xFF, size);
+
+    return 0;
+}
+
+uint32_t FlashIAP::get_page_size() const
+{
+    return stubPageSize;
+}
+
+uint32_t FlashIAP::get_sector_size(uint32_t) const
+{
+    return stubSectorSize;
+}
+
+uint32_t FlashIAP::get_flash_start() const
+{
+    return stubFlashStart;
+}
+
+uint32_t FlashIAP::get_flash_size() const
+{
+    return stubFlashSize;
+}
+
+Timer::Timer() : _start(0), _elapsed(0), _running(false)
+{
+}
+
+void Timer::start()
+{
+    if (!_running)
+    {
+        _start = now();
+        _running = true;
+    }
+}
+
+void Timer::stop()
+{
+    if (_running)
+    {
+        _elapsed += now() - _start;
+        _running = false;
+    }
+}
+
+void Timer::reset()
+{
+    _start = now();
+    _elapsed = 0;
+}
+
+int Timer::read_ms()
+{
+    return read_us() / 1000;
+}
+
+int Timer::read_us()
+{
+    return _elapsed + (_running ? now() - _start : 0);
+}
+
+uint64_t Timer::now() const
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000 + time.tv_nsec / 1000;
+}
+
+DigitalOut::DigitalOut(PinName pin, int value) : _pin(pin), _value(0)
+{
+    *this = value;
+}
+
+DigitalOut& DigitalOut::operator=(int value)
+{
+    _value = value;
+
+    if (stub_spi_device)
+    {
+        stub_spi_device->setPin(_pin, value);
+    }
+
+    return *this;
+}
+
+DigitalOut::operator int()
+{
+    return _value;
+}
+
+SPI::SPI(PinName, PinName, PinName)
+{
+}
+
+void SPI::format(int, int)
+{
+}
+
+void SPI::frequency(int)
+{
+}
+
+void SPI::lock()
+{
+}
+
+void SPI::unlock()
+{
+}
+
+int SPI::write(int value)
+{
+    return stub_spi_device ? stub_spi_device->transfer(value) : 0xFF;
+}
+
+int SPI::write(const char* tx_buffer, int tx_length,
+               char* rx_buffer, int rx_length)
+{
+    int length = (tx_length > rx_length) ? tx_length : rx_length;
+
+    for (int index = 0; index < length; index++)
+    {
+        int value = write((index < tx_length) ? (uint8_t) tx_buffer[index] : 0xFF);
+
+        if (index < rx_length)
+        {
+            rx_buffer[index] = (char) value;
+        }
+    }
+
+    return length;
+}
+
+RawSerial::RawSerial(PinName, PinName, int)
+    : _fd(-1), _attached(false), _stop(false), _thread(0)
+{
+    _fd = stub_serial_device ? open(stub_serial_device, O_RDWR | O_NOCTTY) : -1;
+
+    if (_fd < 0)
+    {
+        perror("RawSerial");
+        exit(2);
+    }
+
+    /* bytes as they are, no line discipline */
+    struct termios settings;
+
+    if (tcgetattr(_fd, &settings) == 0)
+    {
+        cfmakeraw(&settings);
+        tcsetattr(_fd, TCSANOW, &settings);
+    }
+}
+
+RawSerial::~RawSerial()
+{
+    if (_attached)
+    {
+        _stop = true;
+        pthread_join((pthread_t) _thread, 0);
+    }
+
+    close(_fd);
+}
+
+void RawSerial::attach(Callback<void()> handler, IrqType type)
+{
+    if ((type == RxIrq) && !_attached)
+    {
+        pthread_t thread;
+
+        _handler = handler;
+        _attached = (pthread_create(&thread, 0, &RawSerial::interrupt, this) == 0);
+        _thread = (unsigned long) thread;
+    }
+}
+
+int RawSerial::readable()
+{
+    struct pollfd request = { _fd, POLLIN, 0 };
+
+    /* a hung up tty stays readable but has nothing to read */
+    return (poll(&request, 1, 0) == 1) && (request.revents == POLLIN);
+}
+
+int RawSerial::writeable()
+{
+    return 1;
+}
+
+int RawSerial::getc()
+{
+    uint8_t byte = 0;
+
+    return (read(_fd, &byte, 1) == 1) ? byte : -1;
+}
+
+int RawSerial::putc(int c)
+{
+    uint8_t byte = c;
+
+    return (write(_fd, &byte, 1) == 1) ? c : -1;
+}
+
+void* RawSerial::interrupt(void* object)
+{
+    RawSerial* serial = static_cast<RawSerial*>(object);
+
+    while (!serial->_stop)
+    {
+        struct pollfd request = { serial->_fd, POLLIN, 0 };
+
+        if ((poll(&request, 1, 10) == 1) && (request.revents == POLLIN))
+        {
+            serial->_handler.call();
+        }
+        else if (request.revents & (POLLHUP | POLLERR))
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,211 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+/*
+ * Host stand-in for the parts of mbed OS used by the bootloader sources.
+ */
+
+#ifndef STUB_MBED_H
+#define STUB_MBED_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define __WFI()
+
+#ifdef __cplusplus
+
+typedef int PinName;
+
+#define NC (-1)
+
+template <typename F>
+class Callback;
+
+/**
+ * Bound member function, enough for attaching interrupt handlers.
+ */
+template <>
+class Callback<void()>
+{
+public:
+    Callback() : _object(0), _thunk(0)
+    {
+    }
+
+    template <typename T>
+    Callback(T* object, void (T::*method)(void))
+        : _object(object), _thunk(&Callback::thunk<T>)
+    {
+        memcpy(_method, &method, sizeof(method));
+    }
+
+    void call() const
+    {
+        if (_thunk)
+        {
+            _thunk(_object, _method);
+        }
+    }
+
+private:
+    template <typename T>
+    static void thunk(void* object, const char* method)
+    {
+        void (T::*function)(void);
+        memcpy(&function, method, sizeof(function));
+        (static_cast<T*>(object)->*function)();
+    }
+
+    void* _object;
+    void (*_thunk)(void*, const char*);
+    char _method[2 * sizeof(void*)];
+};
+
+class Timer
+{
+public:
+    Timer();
+    void start();
+    void stop();
+    void reset();
+    int read_ms();
+    int read_us();
+
+private:
+    uint64_t now() const;
+
+    uint64_t _start;
+    uint64_t _elapsed;
+    bool _running;
+};
+
+/* internal flash contents, set by the test before use */
+void stub_flash_set(uint8_t* data, uint32_t start, uint32_t size,
+                    uint32_t pageSize, uint32_t sectorSize);
+
+/**
+ * FlashIAP on a RAM image with uniform sectors.
+ * @detail Programming bits from 0 to 1 and unaligned program or erase
+ *         requests fail, as they would on the part.
+ */
+class FlashIAP
+{
+public:
+    int init();
+    int deinit();
+    int read(void* buffer, uint32_t address, uint32_t size);
+    int program(const void* buffer, uint32_t address, uint32_t size);
+    int erase(uint32_t address, uint32_t size);
+    uint32_t get_page_size() const;
+    uint32_t get_sector_size(uint32_t address) const;
+    uint32_t get_flash_start() const;
+    uint32_t get_flash_size() const;
+};
+
+/**
+ * Device on the far end of the stub SPI bus.
+ */
+class StubSPIDevice
+{
+public:
+    virtual ~StubSPIDevice() {}
+
+    /* a DigitalOut on pin was set to value */
+    virtual void setPin(PinName pin, int value) = 0;
+
+    /* one byte clocked out, returns the byte clocked in */
+    virtual uint8_t transfer(uint8_t value) = 0;
+};
+
+/* device behind every SPI and DigitalOut, set by the test before use */
+extern StubSPIDevice* stub_spi_device;
+
+class DigitalOut
+{
+public:
+    DigitalOut(PinName pin, int value = 0);
+    DigitalOut& operator=(int value);
+    operator int();
+
+private:
+    PinName _pin;
+    int _value;
+};
+
+/**
+ * SPI master talking to stub_spi_device, 0xFF is clocked out when only
+ * receiving.
+ */
+class SPI
+{
+public:
+    SPI(PinName mosi, PinName miso, PinName sclk);
+    void format(int bits, int mode = 0);
+    void frequency(int hz = 1000000);
+    void lock();
+    void unlock();
+    int write(int value);
+    int write(const char* tx_buffer, int tx_length,
+              char* rx_buffer, int rx_length);
+};
+
+class SerialBase
+{
+public:
+    enum IrqType {
+        RxIrq = 0,
+        TxIrq
+    };
+};
+
+/* tty opened by the next RawSerial, set by the test before construction */
+extern const char* stub_serial_device;
+
+/**
+ * RawSerial on a host tty.
+ * @detail The RX interrupt is emulated by a thread calling the attached
+ *         handler whenever the tty is readable, so it runs concurrently
+ *         with transmission as it would on the target.
+ */
+class RawSerial : public SerialBase
+{
+public:
+    RawSerial(PinName tx, PinName rx, int baud);
+    ~RawSerial();
+
+    void attach(Callback<void()> handler, IrqType type = RxIrq);
+    int readable();
+    int writeable();
+    int getc();
+    int putc(int c);
+
+private:
+    static void* interrupt(void* serial);
+
+    int _fd;
+    Callback<void()> _handler;
+    bool _attached;
+    volatile bool _stop;
+    unsigned long _thread;
+};
+
+#endif // __cplusplus
+
+#endif // STUB_MBED_H
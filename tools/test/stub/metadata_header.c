@@ -0,0 +1,113 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#include "update-client-common/arm_uc_metadata_header_v2.h"
+#include "update-client-common/arm_uc_utilities.h"
+
+#include <string.h>
+
+#define HEADER_HASH_SIZE 64
+
+static void writeBigEndian(uint8_t* data, uint64_t value, uint32_t length)
+{
+    for (uint32_t index = 0; index < length; index++)
+    {
+        data[index] = value >> (8 * (length - 1 - index));
+    }
+}
+
+static uint64_t readBigEndian(const uint8_t* data, uint32_t length)
+{
+    uint64_t value = 0;
+
+    for (uint32_t index = 0; index < length; index++)
+    {
+        value = (value << 8) | data[index];
+    }
+
+    return value;
+}
+
+uint32_t arm_uc_crc32(const uint8_t* buffer, uint32_t length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t index = 0; index < length; index++)
+    {
+        crc ^= buffer[index];
+
+        for (uint32_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+
+arm_uc_error_t arm_uc_create_internal_header_v2(const arm_uc_firmware_details_t* input,
+                                                arm_uc_buffer_t* output)
+{
+    arm_uc_error_t result = { ERR_NONE };
+
+    if (!input || !output || (output->size_max < ARM_UC_INTERNAL_HEADER_SIZE_V2))
+    {
+        result.error = -1;
+        return result;
+    }
+
+    uint8_t* header = output->ptr;
+
+    memset(header, 0, ARM_UC_INTERNAL_HEADER_SIZE_V2);
+    writeBigEndian(&header[0], ARM_UC_INTERNAL_HEADER_MAGIC_V2, 4);
+    writeBigEndian(&header[4], ARM_UC_INTERNAL_HEADER_VERSION_V2, 4);
+    writeBigEndian(&header[8], input->version, 8);
+    writeBigEndian(&header[16], input->size, 8);
+    memcpy(&header[24], input->hash, ARM_UC_SHA256_SIZE);
+    memcpy(&header[24 + HEADER_HASH_SIZE], input->campaign, ARM_UC_GUID_SIZE);
+
+    uint32_t crc = arm_uc_crc32(header, ARM_UC_INTERNAL_HEADER_SIZE_V2 - 4);
+    writeBigEndian(&header[ARM_UC_INTERNAL_HEADER_SIZE_V2 - 4], crc, 4);
+
+    output->size = ARM_UC_INTERNAL_HEADER_SIZE_V2;
+
+    return result;
+}
+
+arm_uc_error_t arm_uc_parse_internal_header_v2(const uint8_t* input,
+                                               arm_uc_firmware_details_t* output)
+{
+    arm_uc_error_t result = { ERR_NONE };
+
+    uint32_t crc = arm_uc_crc32(input, ARM_UC_INTERNAL_HEADER_SIZE_V2 - 4);
+
+    if ((readBigEndian(&input[0], 4) != ARM_UC_INTERNAL_HEADER_MAGIC_V2) ||
+        (readBigEndian(&input[ARM_UC_INTERNAL_HEADER_SIZE_V2 - 4], 4) != crc))
+    {
+        result.error = -1;
+        return result;
+    }
+
+    output->version = readBigEndian(&input[8], 8);
+    output->size = readBigEndian(&input[16], 8);
+    memcpy(output->hash, &input[24], ARM_UC_SHA256_SIZE);
+    memcpy(output->campaign, &input[24 + HEADER_HASH_SIZE], ARM_UC_GUID_SIZE);
+
+    return result;
+}
@@ -0,0 +1,155 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+#include "update-client-paal/arm_uc_paal_update.h"
+#include "update-client-common/arm_uc_metadata_header_v2.h"
+
+#include <string.h>
+
+static const uint8_t* stubStorage = 0;
+static uint32_t stubStorageSize = 0;
+static uint32_t stubSlotSize = 0;
+static uint32_t stubHeaderSize = 0;
+static const uint8_t* stubActiveHeader = 0;
+static ARM_UC_PAAL_UpdateSignalEvent_t stubCallback = 0;
+
+static uint64_t readBigEndian(const uint8_t* data)
+{
+    uint64_t value = 0;
+
+    for (uint32_t index = 0; index < 8; index++)
+    {
+        value = (value << 8) | data[index];
+    }
+
+    return value;
+}
+
+static void signal(uint32_t event)
+{
+    if (stubCallback)
+    {
+        stubCallback(event);
+    }
+}
+
+void stub_paal_set_storage(const uint8_t* storage, uint32_t size,
+                           uint32_t slotSize, uint32_t headerSize)
+{
+    stubStorage = storage;
+    stubStorageSize = size;
+    stubSlotSize = slotSize;
+    stubHeaderSize = headerSize;
+}
+
+void stub_paal_set_active(const uint8_t* header)
+{
+    stubActiveHeader = header;
+}
+
+arm_uc_error_t ARM_UCP_Initialize(ARM_UC_PAAL_UpdateSignalEvent_t callback)
+{
+    arm_uc_error_t result = { ERR_NONE };
+
+    stubCallback = callback;
+    signal(ARM_UC_PAAL_EVENT_INITIALIZE_DONE);
+
+    return result;
+}
+
+arm_uc_error_t ARM_UCP_Read(uint32_t location, uint32_t offset,
+                            arm_uc_buffer_t* buffer)
+{
+    arm_uc_error_t result = { ERR_NONE };
+    uint64_t start = (uint64_t) location * stubSlotSize + stubHeaderSize + offset;
+
+    if (!buffer || (buffer->size > buffer->size_max) ||
+        (start + buffer->size > stubStorageSize))
+    {
+        result.error = -1;
+        return result;
+    }
+
+    memcpy(buffer->ptr, &stubStorage[start], buffer->size);
+    signal(ARM_UC_PAAL_EVENT_READ_DONE);
+
+    return result;
+}
+
+arm_uc_error_t ARM_UCP_GetFirmwareDetails(uint32_t location,
+                                          arm_uc_firmware_details_t* details)
+{
+    arm_uc_error_t result = { ERR_NONE };
+    uint64_t start = (uint64_t) location * stubSlotSize;
+
+    if (!details || (start + stubHeaderSize > stubStorageSize))
+    {
+        result.error = -1;
+        return result;
+    }
+
+    /* version, size and hash follow the magic and header version */
+    const uint8_t* header = &stubStorage[start];
+    uint32_t erased = 0;
+    uint32_t zero = 0;
+
+    for (uint32_t index = 0; index < 24 + ARM_UC_SHA256_SIZE; index++)
+    {
+        erased += (header[index] == 0xFF);
+        zero += (header[index] == 0x00);
+    }
+
+    if ((erased == 24 + ARM_UC_SHA256_SIZE) || (zero == 24 + ARM_UC_SHA256_SIZE))
+    {
+        signal(ARM_UC_PAAL_EVENT_GET_FIRMWARE_DETAILS_ERROR);
+        return result;
+    }
+
+    details->version = readBigEndian(&header[8]);
+    details->size = readBigEndian(&header[16]);
+    memcpy(details->hash, &header[24], ARM_UC_SHA256_SIZE);
+    memset(details->campaign, 0, ARM_UC_GUID_SIZE);
+
+    signal(ARM_UC_PAAL_EVENT_GET_FIRMWARE_DETAILS_DONE);
+
+    return result;
+}
+
+arm_uc_error_t ARM_UCP_GetActiveFirmwareDetails(arm_uc_firmware_details_t* details)
+{
+    arm_uc_error_t result = { ERR_NONE };
+
+    if (!details || !stubActiveHeader)
+    {
+        result.error = -1;
+        return result;
+    }
+
+    /* the PAAL checks the magic and CRC of the internal header */
+    if (arm_uc_parse_internal_header_v2(stubActiveHeader, details).error == ERR_NONE)
+    {
+        signal(ARM_UC_PAAL_EVENT_GET_ACTIVE_FIRMWARE_DETAILS_DONE);
+    }
+    else
+    {
+        signal(ARM_UC_PAAL_EVENT_GET_FIRMWARE_DETAILS_ERROR);
+    }
+
+    return result;
+}
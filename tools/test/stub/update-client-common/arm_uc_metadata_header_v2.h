@@ -0,0 +1,49 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+/*
+ * Host stand-in for the update client internal header v2.
+ */
+
+#ifndef STUB_ARM_UC_METADATA_HEADER_V2_H
+#define STUB_ARM_UC_METADATA_HEADER_V2_H
+
+#include "update-client-paal/arm_uc_paal_update_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARM_UC_INTERNAL_HEADER_MAGIC_V2   0x5A51B3D4
+#define ARM_UC_INTERNAL_HEADER_VERSION_V2 2
+#define ARM_UC_INTERNAL_HEADER_SIZE_V2    112
+
+/* big endian fields: magic, version, firmware version, size, SHA-512 sized
+   hash, campaign, signature size, then a CRC-32 of the preceding bytes */
+arm_uc_error_t arm_uc_create_internal_header_v2(const arm_uc_firmware_details_t* input,
+                                                arm_uc_buffer_t* output);
+
+arm_uc_error_t arm_uc_parse_internal_header_v2(const uint8_t* input,
+                                               arm_uc_firmware_details_t* output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STUB_ARM_UC_METADATA_HEADER_V2_H
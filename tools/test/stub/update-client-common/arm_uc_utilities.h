@@ -0,0 +1,40 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+/*
+ * Host stand-in for the update client utilities.
+ */
+
+#ifndef STUB_ARM_UC_UTILITIES_H
+#define STUB_ARM_UC_UTILITIES_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* CRC-32 as computed by zlib */
+uint32_t arm_uc_crc32(const uint8_t* buffer, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STUB_ARM_UC_UTILITIES_H
@@ -0,0 +1,64 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+/*
+ * Host stand-in for the update client PAAL, backed by a storage image in
+ * memory. Every call completes synchronously and signals its event before
+ * returning, as the PAAL does in the bootloader.
+ */
+
+#ifndef STUB_ARM_UC_PAAL_UPDATE_H
+#define STUB_ARM_UC_PAAL_UPDATE_H
+
+#include "update-client-paal/arm_uc_paal_update_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Storage image the stub reads from.
+ * @detail Slot index starts at index * slotSize. Its header holds the
+ *         firmware version, size and SHA-256 at the offsets of the
+ *         internal header v2, the firmware follows at headerSize. A slot
+ *         whose header bytes are all erased or all zero is empty.
+ */
+void stub_paal_set_storage(const uint8_t* storage, uint32_t size,
+                           uint32_t slotSize, uint32_t headerSize);
+
+/**
+ * Internal header v2 of the active firmware, read on every request.
+ */
+void stub_paal_set_active(const uint8_t* header);
+
+arm_uc_error_t ARM_UCP_Initialize(ARM_UC_PAAL_UpdateSignalEvent_t callback);
+
+arm_uc_error_t ARM_UCP_Read(uint32_t location, uint32_t offset,
+                            arm_uc_buffer_t* buffer);
+
+arm_uc_error_t ARM_UCP_GetFirmwareDetails(uint32_t location,
+                                          arm_uc_firmware_details_t* details);
+
+arm_uc_error_t ARM_UCP_GetActiveFirmwareDetails(arm_uc_firmware_details_t* details);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STUB_ARM_UC_PAAL_UPDATE_H
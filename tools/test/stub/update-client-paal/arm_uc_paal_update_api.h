@@ -0,0 +1,114 @@
+// ----------------------------------------------------------------------------
+// Copyright 2018 ARM Ltd.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+
+
+/*
+ * Host stand-in for the update client PAAL types.
+ */
+
+#ifndef STUB_ARM_UC_PAAL_UPDATE_API_H
+#define STUB_ARM_UC_PAAL_UPDATE_API_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARM_UC_SHA256_SIZE 32
+#define ARM_UC_GUID_SIZE   16
+
+#define ERR_NONE              0
+#define ERR_INVALID_PARAMETER 1
+
+typedef struct {
+    int32_t error;
+} arm_uc_error_t;
+
+typedef struct {
+    uint32_t size_max;
+    uint32_t size;
+    uint8_t* ptr;
+} arm_uc_buffer_t;
+
+typedef struct {
+    uint64_t version;
+    uint64_t size;
+    uint8_t  hash[ARM_UC_SHA256_SIZE];
+    uint8_t  campaign[ARM_UC_GUID_SIZE];
+} arm_uc_firmware_details_t;
+
+enum {
+    ARM_UC_PAAL_EVENT_INITIALIZE_DONE = 1,
+    ARM_UC_PAAL_EVENT_PREPARE_DONE,
+    ARM_UC_PAAL_EVENT_WRITE_DONE,
+    ARM_UC_PAAL_EVENT_FINALIZE_DONE,
+    ARM_UC_PAAL_EVENT_READ_DONE,
+    ARM_UC_PAAL_EVENT_ACTIVATE_DONE,
+    ARM_UC_PAAL_EVENT_GET_ACTIVE_FIRMWARE_DETAILS_DONE,
+    ARM_UC_PAAL_EVENT_GET_FIRMWARE_DETAILS_DONE,
+    ARM_UC_PAAL_EVENT_GET_INSTALLER_DETAILS_DONE,
+    ARM_UC_PAAL_EVENT_READ_ERROR,
+    ARM_UC_PAAL_EVENT_GET_FIRMWARE_DETAILS_ERROR
+};
+
+typedef void (*ARM_UC_PAAL_UpdateSignalEvent_t)(uint32_t event);
+
+typedef struct {
+    uint32_t installer_arm_hash: 1;
+    uint32_t installer_oem_hash: 1;
+    uint32_t installer_layout: 1;
+    uint32_t firmware_hash: 1;
+    uint32_t firmware_hmac: 1;
+    uint32_t firmware_campaign: 1;
+    uint32_t firmware_version: 1;
+    uint32_t firmware_size: 1;
+} ARM_UC_PAAL_UPDATE_CAPABILITIES;
+
+typedef struct {
+    uint8_t  arm_hash[ARM_UC_SHA256_SIZE];
+    uint8_t  oem_hash[ARM_UC_SHA256_SIZE];
+    uint32_t layout;
+} arm_uc_installer_details_t;
+
+typedef struct _ARM_UC_PAAL_UPDATE {
+    arm_uc_error_t (*Initialize)(ARM_UC_PAAL_UpdateSignalEvent_t callback);
+    ARM_UC_PAAL_UPDATE_CAPABILITIES (*GetCapabilities)(void);
+    uint32_t (*GetMaxID)(void);
+    arm_uc_error_t (*Prepare)(uint32_t location,
+                              const arm_uc_firmware_details_t* details,
+                              arm_uc_buffer_t* buffer);
+    arm_uc_error_t (*Write)(uint32_t location,
+                            uint32_t offset,
+                            const arm_uc_buffer_t* buffer);
+    arm_uc_error_t (*Finalize)(uint32_t location);
+    arm_uc_error_t (*Read)(uint32_t location,
+                           uint32_t offset,
+                           arm_uc_buffer_t* buffer);
+    arm_uc_error_t (*Activate)(uint32_t location);
+    arm_uc_error_t (*GetActiveFirmwareDetails)(arm_uc_firmware_details_t* details);
+    arm_uc_error_t (*GetFirmwareDetails)(uint32_t location,
+                                         arm_uc_firmware_details_t* details);
+    arm_uc_error_t (*GetInstallerDetails)(arm_uc_installer_details_t* details);
+} ARM_UC_PAAL_UPDATE;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STUB_ARM_UC_PAAL_UPDATE_API_H
@@ -0,0 +1,120 @@
+#!/usr/bin/env python
+# ----------------------------------------------------------------------------
+# Copyright 2018 ARM Ltd.
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ----------------------------------------------------------------------------
+
+
+"""
+Tests of SerialCoprocessorTransport against coprocessor_loader.py.
+
+The transport and forwardCoprocessorFirmware() run in build/coprocessor_test,
+built from the bootloader sources by `make check`, and talk to the loader over
+a pseudo terminal.
+"""
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import unittest
+
+TOOLS = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+LOADER = os.path.join(TOOLS, "coprocessor_loader.py")
+DRIVER = os.path.join(TOOLS, "test", "build", "coprocessor_test")
+
+
+@unittest.skipUnless(os.path.exists(DRIVER), "run through `make check`")
+class CoprocessorLoaderTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+        self.output = os.path.join(self.directory, "installed.bin")
+        self.loader = None
+
+    def tearDown(self):
+        if self.loader:
+            self.loader.kill()
+            self.loader.wait()
+            self.loader.stdout.close()
+        shutil.rmtree(self.directory)
+
+    def start_loader(self, *options):
+        self.loader = subprocess.Popen(
+            [sys.executable, LOADER, "--pty", "--once", "-o", self.output] +
+            list(options), stdout=subprocess.PIPE, universal_newlines=True)
+        return self.loader.stdout.readline().strip()
+
+    def run_driver(self, *args):
+        driver = subprocess.Popen([DRIVER] + list(args),
+                                  stdout=subprocess.PIPE,
+                                  universal_newlines=True)
+        output = driver.communicate()[0]
+        return driver.returncode, output
+
+    def write_image(self, size):
+        path = os.path.join(self.directory, "image.bin")
+        with open(path, "wb") as f:
+            f.write(bytearray((i * 7 + (i >> 10)) & 0xFF for i in range(size)))
+        return path
+
+    def test_version(self):
+        device = self.start_loader("-v", "1234")
+        code, output = self.run_driver(device)
+        self.assertEqual(code, 0)
+        self.assertIn("version: 1234", output)
+
+    def test_unknown_version(self):
+        device = self.start_loader("--no-version")
+        code, output = self.run_driver(device)
+        self.assertIn("version: unknown", output)
+
+    def test_forward(self):
+        # answers arrive while later chunks are still being transmitted
+        image = self.write_image(10 * 1024 + 123)
+        device = self.start_loader("-v", "1")
+        code, output = self.run_driver(device, image)
+
+        self.assertEqual(code, 0, output)
+        self.assertIn("forward: committed", output)
+        self.assertEqual(self.loader.stdout.readline().strip(),
+                         "committed {} bytes".format(10 * 1024 + 123))
+        with open(image, "rb") as a, open(self.output, "rb") as b:
+            self.assertEqual(a.read(), b.read())
+
+    def test_slow_loader(self):
+        # every chunk waits for its predecessors to be programmed
+        image = self.write_image(6 * 1024)
+        device = self.start_loader("--delay", "0.05")
+        code, output = self.run_driver(device, image)
+
+        self.assertEqual(code, 0, output)
+        with open(image, "rb") as a, open(self.output, "rb") as b:
+            self.assertEqual(a.read(), b.read())
+
+    def test_hash_mismatch(self):
+        image = self.write_image(3 * 1024)
+        device = self.start_loader()
+        code, output = self.run_driver(device, image, "-c")
+
+        self.assertEqual(code, 1)
+        self.assertIn("forward: failed", output)
+        self.assertEqual(self.loader.stdout.readline().strip(), "aborted")
+        self.assertFalse(os.path.exists(self.output))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,268 @@
+#!/usr/bin/env python
+# ----------------------------------------------------------------------------
+# Copyright 2018 ARM Ltd.
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ----------------------------------------------------------------------------
+
+
+"""
+Tests pinning inspect_dumps.py to the bootloader decision code.
+
+Every fixture is a pair of flash and sd card dumps. The same dumps are
+replayed by the tool and by build/boot_replay, which runs
+upgradeApplicationFromStorage() from the bootloader sources on the host, and
+both must reach the same decision with the same verdict for every slot and
+the same energy counters, printed bytes included. The layout of the dumps is
+the one boot_replay was compiled with.
+"""
+
+import hashlib
+import json
+import os
+import re
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import unittest
+
+TOOLS = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+INSPECT = os.path.join(TOOLS, "inspect_dumps.py")
+REPLAY = os.path.join(TOOLS, "test", "build", "boot_replay")
+
+sys.path.insert(0, TOOLS)
+
+from package_firmware import create_internal_header
+
+SLOT_HEADER_SIZE = 512
+
+
+def make_image(size, seed):
+    return bytes(bytearray((i * 31 + seed * 97 + (i >> 8)) & 0xFF
+                           for i in range(size)))
+
+
+@unittest.skipUnless(os.path.exists(REPLAY), "run through `make check`")
+class InspectDumpsTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.directory = tempfile.mkdtemp()
+        cls.config = os.path.join(cls.directory, "mbed_app.json")
+        with open(cls.config, "w") as f:
+            f.write(subprocess.check_output([REPLAY, "--config"],
+                                            universal_newlines=True))
+        with open(cls.config) as f:
+            macros = dict(m.split("=") for m in json.load(f)["macros"])
+        cls.layout = dict((name, int(value, 0))
+                          for name, value in macros.items())
+
+    @classmethod
+    def tearDownClass(cls):
+        shutil.rmtree(cls.directory)
+
+    def value(self, name):
+        return self.layout["MBED_CONF_" + name]
+
+    def empty_dumps(self):
+        flash = bytearray(b"\xFF" * (self.value("APP_FLASH_SECTOR_SIZE") * 64))
+        sd = bytearray(b"\xFF" * (self.value("UPDATE_CLIENT_STORAGE_ADDRESS") +
+                                  self.value("UPDATE_CLIENT_STORAGE_SIZE")))
+        return flash, sd
+
+    def set_active(self, flash, version, image):
+        start = self.value("APP_FLASH_START_ADDRESS")
+        header = self.value("UPDATE_CLIENT_APPLICATION_DETAILS") - start
+        app = self.value("APP_APPLICATION_START_ADDRESS") - start
+        flash[header:header + 112] = create_internal_header(
+            version, len(image), hashlib.sha256(image).digest(), b"\0" * 16)
+        flash[app:app + len(image)] = image
+
+    def set_slot(self, sd, index, version, image, digest=None):
+        slot_size = self.value("UPDATE_CLIENT_STORAGE_SIZE") // \
+                    self.value("UPDATE_CLIENT_STORAGE_LOCATIONS")
+        start = self.value("UPDATE_CLIENT_STORAGE_ADDRESS") + index * slot_size
+        sd[start:start + 112] = create_internal_header(
+            version, len(image), digest or hashlib.sha256(image).digest(),
+            b"\0" * 16)
+        body = start + SLOT_HEADER_SIZE
+        sd[body:body + len(image)] = image
+
+    def write_device(self, name, flash, sd):
+        device = os.path.join(self.directory, name)
+        os.mkdir(device)
+        with open(os.path.join(device, "flash.bin"), "wb") as f:
+            f.write(flash)
+        with open(os.path.join(device, "sd.bin"), "wb") as f:
+            f.write(sd)
+        return device
+
+    def replay(self, device, output=None):
+        """ Decision, slot verdicts and energy counters of the bootloader code """
+        command = [REPLAY, os.path.join(device, "flash.bin"),
+                   os.path.join(device, "sd.bin")]
+        if output:
+            command += ["-o", output]
+        process = subprocess.Popen(command, stdout=subprocess.PIPE,
+                                   stderr=subprocess.PIPE,
+                                   universal_newlines=True)
+        log, counters = process.communicate()
+
+        slots = {}
+        for index, verdict in re.findall(
+                r"Slot (\d+) (is empty|firmware is of older date|"
+                r"firmware integrity check failed|firmware size too large|"
+                r"firmware integrity check:)", log):
+            slots[int(index)] = {
+                "is empty": "empty",
+                "firmware is of older date": "older",
+                "firmware integrity check failed": "integrity check failed",
+                "firmware size too large": "too large",
+                "firmware integrity check:": "valid"}[verdict]
+
+        installed = re.findall(r"Update active firmware using slot (\d+)", log)
+        if "Active firmware repaired" in log:
+            decision = "repair active firmware from slot " + installed[-1]
+        elif installed:
+            decision = "install slot " + installed[-1]
+        elif "Active firmware up-to-date" in log:
+            decision = "boot active firmware"
+        else:
+            decision = "no valid firmware"
+
+        return decision, slots, json.loads(counters)
+
+    def inspect(self, device, config=None, estimate=False):
+        """ Decision, slot verdicts and energy counters of the tool """
+        report = os.path.join(device, "report.json")
+        subprocess.check_call([sys.executable, INSPECT, device, "-m", "HOST",
+                               "--app-config", config or self.config, "-j", "1",
+                               "-o", report], stdout=subprocess.PIPE)
+        with open(report) as f:
+            report = json.load(f)[0]
+        counters = report["energy"]["boot"]
+        if not estimate:
+            del counters["uJ"]
+        return report["decision"], dict((slot["index"], slot["status"])
+                                        for slot in report["slots"]), counters
+
+    def assert_same_decision(self, device, expected):
+        decision, slots, counters = self.inspect(device)
+        self.assertEqual(decision, expected)
+        self.assertEqual(self.replay(device), (decision, slots, counters))
+
+    def test_up_to_date(self):
+        flash, sd = self.empty_dumps()
+        self.set_active(flash, 2, make_image(20000, 1))
+        self.set_slot(sd, 0, 1, make_image(15000, 2))
+        device = self.write_device("up_to_date", flash, sd)
+        self.assert_same_decision(device, "boot active firmware")
+
+    def test_newer_candidate(self):
+        flash, sd = self.empty_dumps()
+        self.set_active(flash, 1, make_image(20000, 1))
+        self.set_slot(sd, 0, 2, make_image(15000, 2))
+        self.set_slot(sd, 1, 3, make_image(90000, 3))
+        device = self.write_device("newer", flash, sd)
+        self.assert_same_decision(device, "install slot 1")
+
+    def test_corrupt_candidate(self):
+        flash, sd = self.empty_dumps()
+        image = make_image(30000, 2)
+        self.set_active(flash, 1, make_image(20000, 1))
+        self.set_slot(sd, 0, 2, image, hashlib.sha256(image[1:]).digest())
+        device = self.write_device("corrupt_candidate", flash, sd)
+        self.assert_same_decision(device, "boot active firmware")
+
+    def test_candidate_too_large(self):
+        flash, sd = self.empty_dumps()
+        size = self.value("APP_MAX_APPLICATION_SIZE") + 256
+        self.set_active(flash, 1, make_image(20000, 1))
+        self.set_slot(sd, 1, 2, make_image(size, 2))
+        device = self.write_device("too_large", flash, sd)
+        self.assert_same_decision(device, "boot active firmware")
+
+    def test_empty_active(self):
+        flash, sd = self.empty_dumps()
+        self.set_slot(sd, 0, 1, make_image(40000, 1))
+        device = self.write_device("empty_active", flash, sd)
+        self.assert_same_decision(device, "install slot 0")
+
+    def test_no_firmware(self):
+        flash, sd = self.empty_dumps()
+        device = self.write_device("no_firmware", flash, sd)
+        self.assert_same_decision(device, "no valid firmware")
+
+    def test_corrupt_active_without_record(self):
+        flash, sd = self.empty_dumps()
+        image = make_image(70000, 4)
+        self.set_active(flash, 5, image)
+        self.set_slot(sd, 0, 5, image)
+        start = self.value("APP_APPLICATION_START_ADDRESS") - \
+                self.value("APP_FLASH_START_ADDRESS")
+        flash[start + 1000] ^= 0xFF
+        device = self.write_device("corrupt_no_record", flash, sd)
+        self.assert_same_decision(device, "install slot 0")
+
+    def test_corrupt_active_with_record(self):
+        # let the bootloader install the image and write its record
+        flash, sd = self.empty_dumps()
+        image = make_image(100000, 5)
+        self.set_slot(sd, 1, 7, image)
+        device = self.write_device("installed", flash, sd)
+        installed = os.path.join(self.directory, "installed.bin")
+        self.assertEqual(self.replay(device, installed)[0], "install slot 1")
+
+        with open(installed, "rb") as f:
+            flash = bytearray(f.read())
+        start = self.value("APP_APPLICATION_START_ADDRESS") - \
+                self.value("APP_FLASH_START_ADDRESS")
+        flash[start + 70000] ^= 0xFF
+        device = self.write_device("corrupt_with_record", flash, sd)
+        self.assert_same_decision(device, "repair active firmware from slot 1")
+
+    def test_energy_configuration(self):
+        # the estimate follows the read buffer size and the progress bar
+        flash, sd = self.empty_dumps()
+        self.set_active(flash, 1, make_image(20000, 1))
+        self.set_slot(sd, 0, 2, make_image(50000, 2))
+        device = self.write_device("energy", flash, sd)
+
+        def variant(name, macro, value):
+            with open(self.config) as f:
+                config = json.load(f)
+            config["macros"] = [m for m in config["macros"]
+                                if m.split("=")[0] != macro]
+            config["macros"].append("{}={}".format(macro, value))
+            path = os.path.join(self.directory, name + ".json")
+            with open(path, "w") as f:
+                json.dump(config, f)
+            return self.inspect(device, path, estimate=True)[2]
+
+        base = self.inspect(device, estimate=True)[2]
+        large = variant("large_buffer", "BUFFER_SIZE",
+                        4 * self.layout["BUFFER_SIZE"])
+        quiet = variant("no_progress", "SHOW_PROGRESS_BAR", 0)
+
+        self.assertEqual(large["storage_read"], base["storage_read"])
+        self.assertLess(large["storage_read_call"], base["storage_read_call"])
+        self.assertLess(large["uJ"], base["uJ"])
+        self.assertLess(quiet["uart"], base["uart"])
+        self.assertLess(quiet["uJ"], base["uJ"])
+
+
+if __name__ == "__main__":
+    unittest.main()
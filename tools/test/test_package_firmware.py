@@ -0,0 +1,128 @@
+#!/usr/bin/env python
+# ----------------------------------------------------------------------------
+# Copyright 2018 ARM Ltd.
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ----------------------------------------------------------------------------
+
+"""
+Round-trip tests for package_firmware.py.
+
+The header is unpacked with the layout of arm_uc_metadata_header_v2.h written
+out here, not the one from the tool, so a change to either is caught.
+"""
+
+import hashlib
+import json
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import unittest
+import uuid
+import zlib
+
+TOOLS = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+PACKAGE = os.path.join(TOOLS, "package_firmware.py")
+
+HEADER_FORMAT = ">2I2Q64s16sI"
+HEADER_SIZE = 112
+HEADER_MAGIC = 0x5A51B3D4
+
+
+class PackageFirmwareTest(unittest.TestCase):
+
+    def setUp(self):
+        self.dir = tempfile.mkdtemp()
+        self.out = os.path.join(self.dir, "out")
+
+    def tearDown(self):
+        shutil.rmtree(self.dir)
+
+    def write_input(self, name, size, seed):
+        path = os.path.join(self.dir, name)
+        if not os.path.isdir(os.path.dirname(path)):
+            os.makedirs(os.path.dirname(path))
+        data = bytearray((i * 131 + seed) & 0xFF for i in range(size))
+        with open(path, "wb") as f:
+            f.write(data)
+        return path, bytes(data)
+
+    def run_tool(self, *args):
+        return subprocess.call([sys.executable, PACKAGE, "-o", self.out,
+                                "-j", "2"] + list(args),
+                               stdout=subprocess.DEVNULL,
+                               stderr=subprocess.DEVNULL)
+
+    def test_round_trip(self):
+        chunk = 4096
+        campaign = uuid.uuid4()
+        inputs = [self.write_input("a.bin", 3 * chunk + 123, 1),
+                  self.write_input("b.bin", chunk, 2),
+                  self.write_input("c.bin", 17, 3)]
+
+        status = self.run_tool("-v", "1234567", "-c", str(campaign),
+                               "--chunk-size", str(chunk),
+                               *[path for path, _ in inputs])
+        self.assertEqual(status, 0)
+
+        for path, data in inputs:
+            name = os.path.splitext(os.path.basename(path))[0]
+            base = os.path.join(self.out, name)
+
+            with open(base + ".hdr", "rb") as f:
+                header = f.read()
+            self.assertEqual(len(header), HEADER_SIZE)
+
+            magic, header_version, version, size, digest, guid, signature = \
+                struct.unpack(HEADER_FORMAT, header[:-4])
+            crc, = struct.unpack(">I", header[-4:])
+
+            self.assertEqual(magic, HEADER_MAGIC)
+            self.assertEqual(header_version, 2)
+            self.assertEqual(version, 1234567)
+            self.assertEqual(size, len(data))
+            self.assertEqual(digest, hashlib.sha256(data).digest() + b"\0" * 32)
+            self.assertEqual(guid, campaign.bytes)
+            self.assertEqual(signature, 0)
+            self.assertEqual(crc, zlib.crc32(header[:-4]) & 0xFFFFFFFF)
+
+            with open(base + ".bin", "rb") as f:
+                self.assertEqual(f.read(), data)
+
+            with open(base + ".manifest.json") as f:
+                manifest = json.load(f)
+            self.assertEqual(manifest["size"], len(data))
+            self.assertEqual(manifest["sha256"], hashlib.sha256(data).hexdigest())
+
+            offsets = list(range(0, len(data), chunk))
+            self.assertEqual([c["offset"] for c in manifest["chunks"]], offsets)
+            for entry in manifest["chunks"]:
+                part = data[entry["offset"]:entry["offset"] + chunk]
+                self.assertEqual(entry["sha256"], hashlib.sha256(part).hexdigest())
+                self.assertEqual(entry["crc32"], zlib.crc32(part) & 0xFFFFFFFF)
+
+    def test_duplicate_names_rejected(self):
+        first, _ = self.write_input(os.path.join("x", "app.bin"), 100, 1)
+        second, _ = self.write_input(os.path.join("y", "app.bin"), 200, 2)
+
+        self.assertNotEqual(self.run_tool(first, second), 0)
+        self.assertFalse(os.path.exists(os.path.join(self.out, "app.hdr")))
+
+
+if __name__ == "__main__":
+    unittest.main()